@@ -0,0 +1,504 @@
+#include "analyzer.hpp"
+#include "Polyweb/string.hpp"
+#include <algorithm>
+#include <ctype.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+bool is_part_of_speech(std::string_view str) {
+    switch (hash(str)) {
+    case hash("N"):
+    case hash("PRON"):
+    case hash("PACK"):
+    case hash("ADJ"):
+    case hash("NUM"):
+    case hash("ADV"):
+    case hash("V"):
+    case hash("VPAR"):
+    case hash("SUPINE"):
+    case hash("PREP"):
+    case hash("CONJ"):
+    case hash("INTERJ"):
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool genders_match(char entry_gender, char inflection_gender) {
+    return entry_gender == inflection_gender ||
+           entry_gender == 'X' ||
+           inflection_gender == 'X' ||
+           (entry_gender == 'C' && (inflection_gender == 'M' || inflection_gender == 'F')) ||
+           (inflection_gender == 'C' && (entry_gender == 'M' || entry_gender == 'F'));
+}
+
+void strip_line_comment(std::string& line) {
+    size_t comment_pos;
+    if ((comment_pos = line.find("--")) != std::string::npos) {
+        line.erase(comment_pos);
+    }
+    pw::string::trim(line);
+}
+
+// Reads the part of speech and the fields that follow it in an inflection record
+bool parse_inflection(std::istream& ss, Analyzer::Inflection& inflection) {
+    std::string string_part_of_speech;
+    std::string string_case;
+    std::string string_tense;
+    std::string string_voice;
+    std::string string_mood;
+    std::string string_degree;
+    std::string string_type;
+    char char_plurality;
+
+    ss >> string_part_of_speech;
+    switch (hash(string_part_of_speech)) {
+    case hash("N"):
+    case hash("PRON"):
+    case hash("SUPINE"):
+        ss >> inflection.which >> inflection.variant >> string_case >> char_plurality >> inflection.gender;
+        if (string_part_of_speech == "N") {
+            inflection.part_of_speech = PART_OF_SPEECH_NOUN;
+        } else if (string_part_of_speech == "PRON") {
+            inflection.part_of_speech = PART_OF_SPEECH_PRONOUN;
+        } else {
+            inflection.part_of_speech = PART_OF_SPEECH_SUPINE;
+        }
+        break;
+
+    case hash("ADJ"):
+        inflection.part_of_speech = PART_OF_SPEECH_ADJECTIVE;
+        ss >> inflection.which >> inflection.variant >> string_case >> char_plurality >> inflection.gender >> string_degree;
+        inflection.degree = parse_degree(string_degree);
+        break;
+
+    case hash("NUM"):
+        inflection.part_of_speech = PART_OF_SPEECH_NUMERAL;
+        ss >> inflection.which >> inflection.variant >> string_case >> char_plurality >> inflection.gender >> string_type;
+        inflection.numeral_type = parse_numeral_type(string_type);
+        break;
+
+    case hash("V"):
+        inflection.part_of_speech = PART_OF_SPEECH_VERB;
+        ss >> inflection.which >> inflection.variant >> string_tense >> string_voice >> string_mood >> inflection.person >> char_plurality;
+        inflection.tense = parse_tense(string_tense);
+        inflection.voice = parse_voice(string_voice);
+        inflection.mood = parse_mood(string_mood);
+        inflection.plural = char_plurality == 'P';
+        return (bool) ss;
+
+    case hash("VPAR"):
+        inflection.part_of_speech = PART_OF_SPEECH_PARTICIPLE;
+        ss >> inflection.which >> inflection.variant >> string_case >> char_plurality >> inflection.gender >> string_tense >> string_voice >> string_mood;
+        inflection.tense = parse_tense(string_tense);
+        inflection.voice = parse_voice(string_voice);
+        break;
+
+    case hash("ADV"):
+        inflection.part_of_speech = PART_OF_SPEECH_ADVERB;
+        ss >> string_degree;
+        inflection.degree = parse_degree(string_degree);
+        return (bool) ss;
+
+    case hash("PREP"):
+        inflection.part_of_speech = PART_OF_SPEECH_PREPOSITION;
+        ss >> string_case;
+        inflection.casus = parse_casus(string_case);
+        return (bool) ss;
+
+    case hash("CONJ"):
+        inflection.part_of_speech = PART_OF_SPEECH_CONJUNCTION;
+        return (bool) ss;
+
+    case hash("INTERJ"):
+        inflection.part_of_speech = PART_OF_SPEECH_INTERJECTION;
+        return (bool) ss;
+
+    default:
+        return false;
+    }
+
+    inflection.casus = parse_casus(string_case);
+    inflection.plural = char_plurality == 'P';
+    return (bool) ss;
+}
+
+std::string Analyzer::canonicalize(std::string_view word) {
+    std::string ret(word);
+    for (char& c : ret) {
+        c = tolower(c);
+        if (c == 'j') {
+            c = 'i';
+        } else if (c == 'v') {
+            c = 'u';
+        }
+    }
+    return ret;
+}
+
+bool Analyzer::matches(const Entry& entry, const Inflection& inflection) {
+    switch (inflection.part_of_speech) {
+    case PART_OF_SPEECH_VERB:
+    case PART_OF_SPEECH_PARTICIPLE:
+    case PART_OF_SPEECH_SUPINE:
+        if (entry.part_of_speech != PART_OF_SPEECH_VERB) {
+            return false;
+        }
+        break;
+
+    default:
+        if (entry.part_of_speech != inflection.part_of_speech) {
+            return false;
+        }
+        break;
+    }
+
+    if ((inflection.which && inflection.which != entry.which) ||
+        (inflection.variant && inflection.variant != entry.variant)) {
+        return false;
+    }
+
+    switch (entry.part_of_speech) {
+    case PART_OF_SPEECH_NOUN:
+        return genders_match(entry.gender, inflection.gender);
+
+    case PART_OF_SPEECH_ADJECTIVE:
+    case PART_OF_SPEECH_ADVERB:
+        // Entries that are only comparative or only superlative don't take positive endings
+        return entry.degree == DEGREE_NONE || entry.degree == DEGREE_POSITIVE || entry.degree == inflection.degree;
+
+    case PART_OF_SPEECH_PREPOSITION:
+        return entry.casus == inflection.casus;
+
+    default:
+        return true;
+    }
+}
+
+WordForm Analyzer::make_form(const Inflection& inflection, const Entry& entry) {
+    unsigned short which = entry.which ? entry.which : inflection.which;
+    Gender gender = parse_gender(entry.part_of_speech == PART_OF_SPEECH_NOUN && entry.gender != 'X' ? entry.gender : inflection.gender);
+
+    switch (inflection.part_of_speech) {
+    case PART_OF_SPEECH_NOUN: return WordForm::make_noun(which, inflection.casus, inflection.plural, gender);
+    case PART_OF_SPEECH_PRONOUN: return WordForm::make_pronoun(which, inflection.casus, inflection.plural, gender);
+
+    case PART_OF_SPEECH_VERB: {
+        // Limit person
+        Person person = inflection.person;
+        if (person > 0) {
+            --person;
+        }
+        return WordForm::make_verb(which, inflection.tense, inflection.voice, inflection.mood, person, inflection.plural);
+    }
+
+    case PART_OF_SPEECH_PARTICIPLE: return WordForm::make_participle(which, inflection.casus, inflection.plural, gender, inflection.tense, inflection.voice);
+    case PART_OF_SPEECH_SUPINE: return WordForm::make_supine(which, inflection.casus, inflection.plural, gender);
+    case PART_OF_SPEECH_ADJECTIVE: return WordForm::make_adjective(which, inflection.casus, inflection.plural, gender, inflection.degree == DEGREE_NONE ? DEGREE_POSITIVE : inflection.degree);
+    case PART_OF_SPEECH_ADVERB: return WordForm::make_adverb(inflection.degree == DEGREE_NONE ? DEGREE_POSITIVE : inflection.degree);
+    case PART_OF_SPEECH_CONJUNCTION: return WordForm::make_conjunction();
+    case PART_OF_SPEECH_PREPOSITION: return WordForm::make_preposition(entry.casus);
+    case PART_OF_SPEECH_INTERJECTION: return WordForm::make_interjection();
+    case PART_OF_SPEECH_NUMERAL: return WordForm::make_numeral(which, inflection.casus, inflection.plural, gender, inflection.numeral_type == NUMERAL_TYPE_NONE ? NUMERAL_TYPE_CARDINAL : inflection.numeral_type);
+    default: throw std::logic_error("Invalid part of speech");
+    }
+}
+
+Analyzer::Analyzer(const std::string& directory) {
+    load_dictionary(directory + "/DICTLINE.GEN");
+    load_inflections(directory + "/INFLECTS.LAT");
+    load_uniques(directory + "/UNIQUES.LAT");
+    load_addons(directory + "/ADDONS.LAT");
+}
+
+void Analyzer::load_dictionary(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    for (std::string line; std::getline(file, line);) {
+        std::istringstream ss(line);
+        Entry entry;
+
+        // The stems come before the part of speech
+        std::string token;
+        for (size_t i = 0; ss >> token && !is_part_of_speech(token); ++i) {
+            if (i < 4) {
+                entry.stems[i] = std::move(token);
+            }
+        }
+        if (!ss) {
+            continue;
+        }
+
+        try {
+            std::string string_kind;
+            std::string string_case;
+            std::string string_degree;
+            switch (hash(token)) {
+            case hash("N"):
+                entry.part_of_speech = PART_OF_SPEECH_NOUN;
+                ss >> entry.which >> entry.variant >> entry.gender >> string_kind;
+                break;
+
+            case hash("PRON"):
+                entry.part_of_speech = PART_OF_SPEECH_PRONOUN;
+                ss >> entry.which >> entry.variant >> string_kind;
+                break;
+
+            case hash("ADJ"):
+                entry.part_of_speech = PART_OF_SPEECH_ADJECTIVE;
+                ss >> entry.which >> entry.variant >> string_degree;
+                entry.degree = parse_degree(string_degree);
+                break;
+
+            case hash("NUM"):
+                entry.part_of_speech = PART_OF_SPEECH_NUMERAL;
+                ss >> entry.which >> entry.variant >> string_kind >> string_kind;
+                break;
+
+            case hash("ADV"):
+                entry.part_of_speech = PART_OF_SPEECH_ADVERB;
+                ss >> string_degree;
+                entry.degree = parse_degree(string_degree);
+                break;
+
+            case hash("V"):
+                entry.part_of_speech = PART_OF_SPEECH_VERB;
+                ss >> entry.which >> entry.variant >> string_kind;
+                break;
+
+            case hash("PREP"):
+                entry.part_of_speech = PART_OF_SPEECH_PREPOSITION;
+                ss >> string_case;
+                entry.casus = parse_casus(string_case);
+                break;
+
+            case hash("CONJ"): entry.part_of_speech = PART_OF_SPEECH_CONJUNCTION; break;
+            case hash("INTERJ"): entry.part_of_speech = PART_OF_SPEECH_INTERJECTION; break;
+            default: continue; // Packons need tackons to mean anything
+            }
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+
+        char area;
+        char geography;
+        char source;
+        ss >> entry.age >> area >> geography >> entry.frequency >> source;
+        if (!ss) {
+            continue;
+        }
+        std::getline(ss, entry.definition);
+        pw::string::trim(entry.definition);
+
+        // Lines starting with a pipe continue the definition of the previous entry
+        if (!entry.definition.empty() && entry.definition.front() == '|') {
+            if (!entries.empty() &&
+                entries.back().part_of_speech == entry.part_of_speech &&
+                std::equal(std::begin(entry.stems), std::end(entry.stems), std::begin(entries.back().stems))) {
+                entries.back().definition += ' ' + entry.definition.substr(1);
+            }
+            continue;
+        }
+
+        if ((entry.english_base = find_english_base(strip_comments(entry.definition))).empty()) {
+            continue;
+        }
+
+        uint32_t entry_index = entries.size();
+        for (uint8_t i = 0; i < 4; ++i) {
+            if (!entry.stems[i].empty() && entry.stems[i] != "zzz") {
+                stems[canonicalize(entry.stems[i])].push_back({entry_index, i + 1});
+            }
+        }
+        entries.push_back(std::move(entry));
+    }
+}
+
+void Analyzer::load_inflections(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    for (std::string line; std::getline(file, line);) {
+        strip_line_comment(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        std::istringstream ss(line);
+        Inflection inflection;
+        try {
+            if (!parse_inflection(ss, inflection)) {
+                continue;
+            }
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+
+        unsigned short ending_size;
+        ss >> inflection.stem_key >> ending_size;
+        if (ending_size) {
+            ss >> inflection.ending;
+        }
+        if (!ss) {
+            continue;
+        }
+
+        max_ending_size = std::max(max_ending_size, inflection.ending.size());
+        endings[canonicalize(inflection.ending)].push_back(inflections.size());
+        inflections.push_back(std::move(inflection));
+    }
+}
+
+void Analyzer::load_uniques(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    // Each unique takes up four lines: the word, its inflection, its translation codes, and its definition
+    std::string lines[4];
+    for (size_t i = 0; std::getline(file, lines[i]);) {
+        strip_line_comment(lines[i]);
+        if (lines[i].empty() || ++i < 4) {
+            continue;
+        }
+        i = 0;
+
+        std::istringstream ss(lines[1]);
+        Inflection inflection;
+        try {
+            if (!parse_inflection(ss, inflection)) {
+                continue;
+            }
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+
+        // Uniques get an entry of their own, so they can be treated just like regular words
+        Entry entry;
+        entry.part_of_speech = inflection.part_of_speech;
+        entry.casus = inflection.casus;
+        entry.definition = lines[3];
+        if (!(entry.english_base = find_english_base(strip_comments(entry.definition))).empty()) {
+            uniques[canonicalize(lines[0])].push_back({std::move(entry), std::move(inflection)});
+        }
+    }
+}
+
+void Analyzer::load_addons(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    // Each addon takes up three lines: the fix, what it attaches to, and its definition
+    // Only prefixes are used, since the sentence resolver already splits off tackons like -que, -cum, and -ne
+    std::string lines[3];
+    for (size_t i = 0; std::getline(file, lines[i]);) {
+        strip_line_comment(lines[i]);
+        if (lines[i].empty() || ++i < 3) {
+            continue;
+        }
+        i = 0;
+
+        std::istringstream fix_ss(lines[0]);
+        std::string kind;
+        Prefix prefix;
+        if (!(fix_ss >> kind >> prefix.fix) || kind != "PREFIX") {
+            continue;
+        }
+
+        std::istringstream root_ss(lines[1]);
+        std::string string_root;
+        if (!(root_ss >> string_root)) {
+            continue;
+        }
+        if (string_root == "X") {
+            prefix.root = PART_OF_SPEECH_NOUN;
+            prefix.any_root = true;
+        } else {
+            try {
+                prefix.root = parse_part_of_speech(string_root);
+            } catch (const std::runtime_error&) {
+                continue;
+            }
+            prefix.any_root = false;
+        }
+
+        prefix.fix = canonicalize(prefix.fix);
+        prefixes.push_back(std::move(prefix));
+    }
+
+    // Try longer prefixes first
+    std::stable_sort(prefixes.begin(), prefixes.end(), [](const auto& a, const auto& b) {
+        return a.fix.size() > b.fix.size();
+    });
+}
+
+size_t Analyzer::analyze_stems(std::string_view word, std::vector<WordVariant>& ret) const {
+    size_t first_variant = ret.size();
+    std::vector<uint32_t> variant_entries;
+    for_each_stem_analysis(canonicalize(word), [this, word, &ret, first_variant, &variant_entries](uint32_t entry_index, const Inflection& inflection, size_t stem_size) {
+        const Entry& entry = entries[entry_index];
+
+        // Forms of the same entry are grouped into one variant
+        size_t variant_index = std::find(variant_entries.begin(), variant_entries.end(), entry_index) - variant_entries.begin();
+        if (variant_index == variant_entries.size()) {
+            variant_entries.push_back(entry_index);
+            ret.push_back({
+                .english_base = entry.english_base,
+                .definition = entry.definition,
+                .breakdown = stem_size < word.size() ? std::string(word.substr(0, stem_size)) + '.' + std::string(word.substr(stem_size)) : std::string(word),
+            });
+        }
+        ret[first_variant + variant_index].forms.push_back(make_form(inflection, entry));
+    });
+
+    // Uncommon and archaic entries are only used if nothing else matches
+    if (std::find_if(variant_entries.begin(), variant_entries.end(), [this](uint32_t entry_index) {
+            return entries[entry_index].is_common();
+        }) != variant_entries.end()) {
+        for (size_t i = variant_entries.size(); i-- > 0;) {
+            if (!entries[variant_entries[i]].is_common()) {
+                ret.erase(ret.begin() + first_variant + i);
+            }
+        }
+    }
+
+    return ret.size();
+}
+
+size_t Analyzer::analyze(std::string_view word, std::vector<WordVariant>& ret) const {
+    size_t original_size = ret.size();
+
+    decltype(uniques)::const_iterator unique_it;
+    if ((unique_it = uniques.find(canonicalize(word))) != uniques.end()) {
+        for (const auto& record : unique_it->second) {
+            ret.push_back({
+                .forms = {make_form(record.second, record.first)},
+                .english_base = record.first.english_base,
+                .definition = record.first.definition,
+                .breakdown = std::string(word),
+            });
+        }
+    }
+    analyze_stems(word, ret);
+
+    // Fall back to removing prefixes
+    if (ret.size() == original_size) {
+        analyze_prefixes(word, prefixes, [this](std::string_view word, std::vector<WordVariant>& ret) {
+            return analyze_stems(word, ret);
+        },
+            ret);
+    }
+
+    return ret.size();
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "dictionary.hpp"
+#include "words.hpp"
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A native reimplementation of the core of Whitaker's Words, driven by the same data files (DICTLINE.GEN, INFLECTS.LAT, UNIQUES.LAT, and ADDONS.LAT).
+// Words are split into every possible stem + ending pair, and each pair is checked against the stem and inflection tables.
+class Analyzer {
+public:
+    struct Entry {
+        std::string stems[4];
+        PartOfSpeech part_of_speech;
+        unsigned short which = 0;
+        unsigned short variant = 0;
+        char gender = 'X';
+        Degree degree = DEGREE_NONE;
+        Casus casus = CASUS_NONE;
+        char age = 'X';
+        char frequency = 'X';
+        std::string definition;
+        std::string english_base;
+
+        bool is_common() const {
+            return age != 'A' && frequency != 'F' && frequency != 'I' && frequency != 'M' && frequency != 'N';
+        }
+    };
+
+    struct Inflection {
+        PartOfSpeech part_of_speech;
+        unsigned short which = 0;
+        unsigned short variant = 0;
+        Casus casus = CASUS_NONE;
+        bool plural = false;
+        char gender = 'X';
+        Tense tense = TENSE_NONE;
+        Voice voice = VOICE_NONE;
+        Mood mood = MOOD_NONE;
+        Person person = 0;
+        Degree degree = DEGREE_NONE;
+        NumeralType numeral_type = NUMERAL_TYPE_NONE;
+        unsigned short stem_key = 0;
+        std::string ending;
+    };
+
+    struct Prefix {
+        std::string fix;
+        PartOfSpeech root;
+        bool any_root;
+    };
+
+protected:
+    std::vector<Entry> entries;
+    std::vector<Inflection> inflections;
+    std::vector<Prefix> prefixes;
+
+    std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint8_t>>> stems; // Canonical stem -> (entry, stem key)
+    std::unordered_map<std::string, std::vector<uint32_t>> endings;                  // Canonical ending -> inflections
+    std::unordered_map<std::string, std::vector<std::pair<Entry, Inflection>>> uniques;
+    size_t max_ending_size = 0;
+
+    void load_dictionary(const std::string& path);
+    void load_inflections(const std::string& path);
+    void load_uniques(const std::string& path);
+    void load_addons(const std::string& path);
+
+    size_t analyze_stems(std::string_view word, std::vector<WordVariant>& ret) const;
+
+    // Calls cb(entry_index, inflection, stem_size) for every stem + ending pair the canonical word splits into, shortest ending first
+    template <typename F>
+    void for_each_stem_analysis(const std::string& canonical_word, F cb) const {
+        for (size_t ending_size = 0; ending_size < canonical_word.size() && ending_size <= max_ending_size; ++ending_size) {
+            size_t stem_size = canonical_word.size() - ending_size;
+
+            decltype(endings)::const_iterator ending_it;
+            decltype(stems)::const_iterator stem_it;
+            if ((ending_it = endings.find(canonical_word.substr(stem_size))) == endings.end() ||
+                (stem_it = stems.find(canonical_word.substr(0, stem_size))) == stems.end()) {
+                continue;
+            }
+
+            for (uint32_t inflection_index : ending_it->second) {
+                const Inflection& inflection = inflections[inflection_index];
+                for (const auto& stem : stem_it->second) {
+                    if (stem.second == inflection.stem_key && matches(entries[stem.first], inflection)) {
+                        cb(stem.first, inflection, stem_size);
+                    }
+                }
+            }
+        }
+    }
+
+public:
+    // Throws std::runtime_error if any of the data files can't be opened
+    Analyzer(const std::string& directory = "whitakers-words");
+
+    size_t analyze(std::string_view word, std::vector<WordVariant>& ret) const;
+
+    // Calls cb(word) for every canonical word that can be formed, starting with the uniques
+    // A word may be passed more than once
+    template <typename F>
+    void for_each_form(F cb) const {
+        for (const auto& unique : uniques) {
+            cb(unique.first);
+        }
+
+        std::vector<std::vector<uint32_t>> entries_by_part_of_speech(PART_OF_SPEECH_NUMERAL + 1);
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            entries_by_part_of_speech[entries[i].part_of_speech].push_back(i);
+        }
+
+        for (const auto& inflection : inflections) {
+            std::string ending = canonicalize(inflection.ending);
+            PartOfSpeech part_of_speech = inflection.part_of_speech == PART_OF_SPEECH_PARTICIPLE || inflection.part_of_speech == PART_OF_SPEECH_SUPINE ? PART_OF_SPEECH_VERB : inflection.part_of_speech;
+            for (uint32_t entry_index : entries_by_part_of_speech[part_of_speech]) {
+                const Entry& entry = entries[entry_index];
+                if (inflection.stem_key < 1 || inflection.stem_key > 4 || !matches(entry, inflection)) {
+                    continue;
+                }
+
+                const std::string& stem = entry.stems[inflection.stem_key - 1];
+                if (!stem.empty() && stem != "zzz") {
+                    cb(canonicalize(stem) + ending);
+                }
+            }
+        }
+    }
+
+    // Calls cb(entry, inflection, stem_size, unique) for every analysis of the canonical word, in the order analyze reports them
+    // The uniques come first, and aren't tried again without a prefix
+    template <typename F>
+    void for_each_analysis(const std::string& canonical_word, F cb) const {
+        decltype(uniques)::const_iterator unique_it;
+        if ((unique_it = uniques.find(canonical_word)) != uniques.end()) {
+            for (const auto& record : unique_it->second) {
+                cb(record.first, record.second, canonical_word.size(), true);
+            }
+        }
+        for_each_stem_analysis(canonical_word, [this, &cb](uint32_t entry_index, const Inflection& inflection, size_t stem_size) {
+            cb(entries[entry_index], inflection, stem_size, false);
+        });
+    }
+
+    const std::vector<Prefix>& get_prefixes() const {
+        return prefixes;
+    }
+
+    // Lowercases the word and folds j into i and v into u, as Whitaker does
+    static std::string canonicalize(std::string_view word);
+    static bool matches(const Entry& entry, const Inflection& inflection);
+    static WordForm make_form(const Inflection& inflection, const Entry& entry);
+};
+
+// Retries a failed lookup without each prefix, keeping only the forms the prefix can attach to
+template <typename F>
+size_t analyze_prefixes(std::string_view word, const std::vector<Analyzer::Prefix>& prefixes, F analyze, std::vector<WordVariant>& ret) {
+    std::string canonical_word = Analyzer::canonicalize(word);
+    for (const auto& prefix : prefixes) {
+        if (canonical_word.size() <= prefix.fix.size() || canonical_word.compare(0, prefix.fix.size(), prefix.fix)) {
+            continue;
+        }
+
+        size_t first_variant = ret.size();
+        analyze(word.substr(prefix.fix.size()), ret);
+        for (auto variant_it = ret.begin() + first_variant; variant_it != ret.end();) {
+            if (!prefix.any_root) {
+                variant_it->forms.erase(std::remove_if(variant_it->forms.begin(), variant_it->forms.end(), [&prefix](const auto& form) {
+                    return prefix.root == PART_OF_SPEECH_VERB ? !form.is_verb_like() : form.part_of_speech != prefix.root;
+                }),
+                    variant_it->forms.end());
+            }
+            if (!variant_it->is_valid()) {
+                variant_it = ret.erase(variant_it);
+            } else {
+                variant_it->breakdown.insert(0, std::string(word.substr(0, prefix.fix.size())) + '.');
+                ++variant_it;
+            }
+        }
+
+        if (ret.size() != first_variant) {
+            break;
+        }
+    }
+    return ret.size();
+}
@@ -0,0 +1,313 @@
+#include "../Polyweb/string.hpp"
+#include "../dictionary.hpp"
+#include "../json.hpp"
+#include "../sentence.hpp"
+#include "../words.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctype.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using nlohmann::json;
+
+// Every allocation in the process goes through these, so the benchmarks can report allocations per operation
+std::atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ret = malloc(size ? size : 1)) {
+        return ret;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// Keeps the optimizer from throwing away results that are never used
+template <typename T>
+void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Calls setup() and then cb() once per operation, timing each call of cb separately
+// setup() is neither timed nor counted towards allocations
+template <typename S, typename F>
+void run_benchmark(const std::string& name, size_t operations, S setup, F cb) {
+    if (!operations) {
+        return;
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(operations);
+    size_t allocations = 0;
+    for (size_t i = 0; i < operations; ++i) {
+        setup(i);
+        size_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+        auto start_time = std::chrono::steady_clock::now();
+        cb(i);
+        auto end_time = std::chrono::steady_clock::now();
+        allocations += allocation_count.load(std::memory_order_relaxed) - allocations_before;
+        latencies.push_back(std::chrono::duration<double, std::nano>(end_time - start_time).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::left << std::setw(32) << name << std::right
+              << std::setw(10) << operations
+              << std::setw(14) << std::fixed << std::setprecision(0) << latencies[latencies.size() / 2]
+              << std::setw(14) << latencies[std::min(latencies.size() * 99 / 100, latencies.size() - 1)]
+              << std::setw(14) << std::setprecision(1) << (double) allocations / operations << std::endl;
+}
+
+template <typename F>
+void run_benchmark(const std::string& name, size_t operations, F cb) {
+    run_benchmark(name, operations, [](size_t) {}, cb);
+}
+
+// Runs each sentence in <directory>/sentences.tsv through both resolution engines and compares the IR with what's expected
+// Each line holds a sentence, its IR from the greedy engine, and its IR from the beam engine, separated by tabs (IR is left empty for sentences that can't be analyzed)
+// The words are looked up in the small dictionary in the same directory, so that updates to Whitaker's Words don't change the expected output
+int check_golden(const std::string& directory, bool update) {
+    std::string sentences_path = directory + "/sentences.tsv";
+    std::ifstream sentences_file(sentences_path);
+    if (!sentences_file.is_open()) {
+        std::cerr << "Error: Failed to open " << sentences_path << std::endl;
+        return 1;
+    }
+    std::vector<std::vector<std::string>> cases;
+    for (std::string line; std::getline(sentences_file, line);) {
+        if (!line.empty()) {
+            std::vector<std::string> fields;
+            for (size_t begin = 0, end;; begin = end + 1) {
+                end = line.find('\t', begin);
+                fields.push_back(line.substr(begin, end - begin));
+                if (end == std::string::npos) {
+                    break;
+                }
+            }
+            fields.resize(3);
+            cases.push_back(std::move(fields));
+        }
+    }
+    sentences_file.close();
+
+    init_dictionary(directory, directory + "/lexicon.bin");
+
+    static constexpr ResolutionEngine engines[] = {RESOLUTION_ENGINE_GREEDY, RESOLUTION_ENGINE_BEAM};
+    static constexpr const char* engine_names[] = {"greedy", "beam"};
+
+    SentenceAnalyzer analyzer;
+    size_t mismatches = 0;
+    for (auto& fields : cases) {
+        for (size_t i = 0; i < 2; ++i) {
+            SentenceAnalyzer::Result result;
+            std::string ir = analyzer.analyze(fields[0], result, engines[i]) ? std::move(result.ir) : std::string();
+            if (ir != fields[i + 1]) {
+                if (!update) {
+                    std::cerr << "Mismatch (" << engine_names[i] << ") for \"" << fields[0] << "\":\n"
+                              << "    expected: " << fields[i + 1] << "\n"
+                              << "    got:      " << ir << std::endl;
+                }
+                fields[i + 1] = std::move(ir);
+                ++mismatches;
+            }
+        }
+    }
+
+    if (update) {
+        std::ofstream output(sentences_path);
+        if (!output.is_open()) {
+            std::cerr << "Error: Failed to open " << sentences_path << std::endl;
+            return 1;
+        }
+        for (const auto& fields : cases) {
+            output << fields[0] << '\t' << fields[1] << '\t' << fields[2] << '\n';
+        }
+        std::cout << "Updated " << mismatches << " IR(s) in " << sentences_path << std::endl;
+        return 0;
+    }
+    if (mismatches) {
+        std::cerr << mismatches << " of " << cases.size() * 2 << " golden IRs don't match" << std::endl;
+        return 1;
+    }
+    std::cout << "All " << cases.size() << " golden sentences match" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && !strcmp(argv[1], "golden")) {
+        bool update = argc >= 3 && !strcmp(argv[argc - 1], "--update");
+        return check_golden(argc >= 3 + update ? argv[2] : "bench/golden", update);
+    }
+
+    std::string corpus_path = argc >= 2 ? argv[1] : "bench/corpus.txt";
+    size_t rounds = argc >= 3 ? std::stoull(argv[2]) : 20;
+
+    std::ifstream corpus_file(corpus_path);
+    if (!corpus_file.is_open()) {
+        std::cerr << "Error: Failed to open " << corpus_path << std::endl;
+        return 1;
+    }
+    std::vector<std::string> corpus;
+    for (std::string line; std::getline(corpus_file, line);) {
+        if (!line.empty()) {
+            corpus.push_back(line);
+        }
+    }
+    if (corpus.empty()) {
+        std::cerr << "Error: " << corpus_path << " is empty" << std::endl;
+        return 1;
+    }
+
+    switch (init_dictionary()) {
+    case DICTIONARY_BACKEND_LEXICON: std::cout << "Using precompiled lexicon" << std::endl; break;
+    case DICTIONARY_BACKEND_ANALYZER: std::cout << "Using native analyzer" << std::endl; break;
+    case DICTIONARY_BACKEND_WHITAKERS_WORDS: std::cout << "Using Whitaker's Words subprocesses" << std::endl; break;
+    }
+
+    // Everything below is derived from the corpus up front, so that every run measures the same work
+    Transliterator transliterator;
+    std::vector<std::string> words;
+    for (const auto& sentence : corpus) {
+        for (std::string word : pw::string::split_and_trim(transliterator(sentence), ' ')) {
+            word.erase(std::remove_if(word.begin(), word.end(), ispunct), word.end());
+            if (!word.empty()) {
+                words.push_back(std::move(word));
+            }
+        }
+    }
+
+    SentenceAnalyzer analyzer;
+    std::vector<SentenceAnalyzer::Result> looked_up_sentences;
+    std::vector<std::pair<WordForm, std::string>> forms;
+    for (const auto& sentence : corpus) {
+        SentenceAnalyzer::Result result;
+        if (analyzer.analyze(sentence, result)) {
+            for (const auto& word : result.words) {
+                for (const auto& variant : word) {
+                    for (const auto& form : word.forms(variant)) {
+                        forms.push_back({form, variant.english_base});
+                    }
+                }
+            }
+            looked_up_sentences.push_back(std::move(result));
+        }
+    }
+    std::cout << corpus.size() << " sentences (" << looked_up_sentences.size() << " found in the dictionary), " << words.size() << " words, " << forms.size() << " forms" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << std::left << std::setw(32) << "Benchmark" << std::right
+              << std::setw(10) << "Ops"
+              << std::setw(14) << "p50 (ns)"
+              << std::setw(14) << "p99 (ns)"
+              << std::setw(14) << "Allocs/op" << std::endl;
+
+    std::string transliterated_sentence;
+    run_benchmark("Transliterator", corpus.size() * rounds, [&](size_t i) {
+        transliterator(corpus[i % corpus.size()], transliterated_sentence);
+        do_not_optimize(transliterated_sentence);
+    });
+
+    run_benchmark(
+        "query_dictionary (cold)",
+        words.size() * rounds,
+        [](size_t) {
+            dictionary_cache.clear();
+        },
+        [&](size_t i) {
+            VariantsView word;
+            do_not_optimize(query_dictionary(words[i % words.size()], word));
+        });
+
+    for (const auto& word : words) {
+        VariantsView variants;
+        query_dictionary(word, variants);
+    }
+    run_benchmark("query_dictionary (warm)", words.size() * rounds, [&](size_t i) {
+        VariantsView word;
+        do_not_optimize(query_dictionary(words[i % words.size()], word));
+    });
+
+    SentenceAnalyzer::Result result;
+    run_benchmark("SentenceAnalyzer::split", corpus.size() * rounds, [&](size_t i) {
+        analyzer.split(corpus[i % corpus.size()], result);
+    });
+
+    run_benchmark(
+        "SentenceAnalyzer::lookup",
+        corpus.size() * rounds,
+        [&](size_t i) {
+            analyzer.split(corpus[i % corpus.size()], result);
+        },
+        [&](size_t) {
+            do_not_optimize(analyzer.lookup(result));
+        });
+
+    run_benchmark("SentenceAnalyzer::resolve (beam)", looked_up_sentences.size() * rounds, [&](size_t i) {
+        analyzer.resolve(looked_up_sentences[i % looked_up_sentences.size()], RESOLUTION_ENGINE_BEAM);
+    });
+
+    run_benchmark("SentenceAnalyzer::resolve", looked_up_sentences.size() * rounds, [&](size_t i) {
+        analyzer.resolve(looked_up_sentences[i % looked_up_sentences.size()]);
+    });
+
+    run_benchmark("SentenceAnalyzer::render", looked_up_sentences.size() * rounds, [&](size_t i) {
+        analyzer.render(looked_up_sentences[i % looked_up_sentences.size()]);
+    });
+
+    run_benchmark("SentenceAnalyzer::analyze", corpus.size() * rounds, [&](size_t i) {
+        do_not_optimize(analyzer.analyze(corpus[i % corpus.size()], result));
+    });
+
+    run_benchmark("tokenize", forms.size() * rounds, [&](size_t i) {
+        do_not_optimize(tokenize(forms[i % forms.size()].first));
+    });
+
+    run_benchmark("english_equivalent", forms.size() * rounds, [&](size_t i) {
+        const auto& form = forms[i % forms.size()];
+        do_not_optimize(english_equivalent(form.first, form.second));
+    });
+
+    run_benchmark("to_json", forms.size() * rounds, [&](size_t i) {
+        json form = forms[i % forms.size()].first;
+        do_not_optimize(form.size());
+    });
+
+    std::string serialized_form;
+    run_benchmark("serialize_form", forms.size() * rounds, [&](size_t i) {
+        serialized_form.clear();
+        serialize_form(serialized_form, forms[i % forms.size()].first, forms[i % forms.size()].second);
+        do_not_optimize(serialized_form);
+    });
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+import sys
+import time
+import requests
+from concurrent.futures import ThreadPoolExecutor
+
+if len(sys.argv) < 2:
+    print("Error: Too few arguments", file=sys.stderr)
+    print(f"Usage: {sys.argv[0]} <corpus> [requests] [concurrency] [base url]", file=sys.stderr)
+    sys.exit(1)
+
+sentences = [line.strip() for line in open(sys.argv[1], "rt") if line.strip()]
+request_count = int(sys.argv[2]) if len(sys.argv) >= 3 else 2000
+concurrency = int(sys.argv[3]) if len(sys.argv) >= 4 else 8
+base_url = sys.argv[4] if len(sys.argv) >= 5 else "http://localhost:8000"
+
+words = [word.strip(".,;:!?") for sentence in sentences for word in sentence.split()]
+words = [word for word in words if word]
+
+
+def run_benchmark(name, endpoint, param, inputs):
+    session = requests.Session()
+
+    def send(i):
+        start_time = time.perf_counter()
+        req = session.get(base_url + endpoint,
+                          params={param: inputs[i % len(inputs)]})
+        return time.perf_counter() - start_time, req.status_code
+
+    start_time = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=concurrency) as executor:
+        results = list(executor.map(send, range(request_count)))
+    elapsed = time.perf_counter() - start_time
+
+    latencies = sorted(latency for latency, _ in results)
+    errors = sum(status_code >= 500 for _, status_code in results)
+    p50 = latencies[len(latencies) // 2] * 1000
+    p99 = latencies[min(len(latencies) * 99 // 100, len(latencies) - 1)] * 1000
+    print(f"{name:<16}{request_count:>10}{request_count / elapsed:>12.0f}{p50:>12.2f}{p99:>12.2f}{errors:>10}")
+
+
+print(f"{'Benchmark':<16}{'Requests':>10}{'Req/s':>12}{'p50 (ms)':>12}{'p99 (ms)':>12}{'Errors':>10}")
+run_benchmark("/word_info", "/word_info", "word", words)
+run_benchmark("/sentence_info", "/sentence_info", "sentence", sentences)
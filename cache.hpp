@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <unordered_map>
+#include <utility>
+
+struct CacheStats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t size;
+    size_t budget;
+};
+
+// A concurrent LRU cache split into independently locked shards
+// Each shard gets an equal slice of the memory budget, and evicts its least recently used entries when it goes over
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class LRUCache {
+protected:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t size;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries; // Most recently used first
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash, KeyEqual> index;
+        size_t size = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shard_count;
+    std::atomic<size_t> budget;
+    std::atomic<size_t> hits {0};
+    std::atomic<size_t> misses {0};
+    std::atomic<size_t> evictions {0};
+    Hash hasher;
+
+    Shard& shard_for(const Key& key) {
+        return shards[hasher(key) % shard_count];
+    }
+
+    void evict(Shard& shard) {
+        size_t shard_budget = budget.load(std::memory_order_relaxed) / shard_count;
+        while (shard.size > shard_budget && !shard.entries.empty()) {
+            shard.size -= shard.entries.back().size;
+            shard.index.erase(shard.entries.back().key);
+            shard.entries.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    LRUCache(size_t budget, size_t shard_count = 16):
+        shards(new Shard[shard_count]),
+        shard_count(shard_count),
+        budget(budget) {}
+
+    bool get(const Key& key, Value& ret) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto entry_it = shard.index.find(key);
+        if (entry_it == shard.index.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        shard.entries.splice(shard.entries.begin(), shard.entries, entry_it->second);
+        ret = entry_it->second->value;
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // The size is the caller's estimate of how much memory the entry takes up, including its key
+    void put(const Key& key, Value value, size_t size) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto entry_it = shard.index.find(key);
+        if (entry_it != shard.index.end()) {
+            shard.size -= entry_it->second->size;
+            entry_it->second->value = std::move(value);
+            entry_it->second->size = size;
+            shard.entries.splice(shard.entries.begin(), shard.entries, entry_it->second);
+        } else {
+            shard.entries.push_front({key, std::move(value), size});
+            shard.index[key] = shard.entries.begin();
+        }
+        shard.size += size;
+        evict(shard);
+    }
+
+    void set_budget(size_t budget) {
+        this->budget.store(budget, std::memory_order_relaxed);
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            evict(shards[i]);
+        }
+    }
+
+    void clear() {
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            shards[i].entries.clear();
+            shards[i].index.clear();
+            shards[i].size = 0;
+        }
+    }
+
+    CacheStats stats() {
+        CacheStats ret = {
+            .hits = hits.load(std::memory_order_relaxed),
+            .misses = misses.load(std::memory_order_relaxed),
+            .evictions = evictions.load(std::memory_order_relaxed),
+            .entries = 0,
+            .size = 0,
+            .budget = budget.load(std::memory_order_relaxed),
+        };
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            ret.entries += shards[i].entries.size();
+            ret.size += shards[i].size;
+        }
+        return ret;
+    }
+};
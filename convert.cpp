@@ -0,0 +1,139 @@
+#include "convert.hpp"
+#include "sentence.hpp"
+#include "worker_pool.hpp"
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct CorpusBatch {
+    size_t first_line = 0;
+    std::vector<std::string> lines;
+    std::vector<std::string_view> sentences;
+    std::vector<std::optional<std::string>> output_sentences;
+};
+
+std::string_view trim(std::string_view str) {
+    size_t begin = str.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return str.substr(begin, str.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+bool read_corpus_batch(std::istream& input, CorpusBatch& batch, size_t first_line, size_t max_size) {
+    batch.first_line = first_line;
+    batch.lines.clear();
+    batch.sentences.clear();
+    for (std::string line; batch.lines.size() < max_size && std::getline(input, line);) {
+        batch.lines.push_back(std::move(line));
+    }
+
+    // The Latin is everything before the first tab
+    for (const auto& line : batch.lines) {
+        std::string_view trimmed_line = trim(line);
+        size_t tab_pos = trimmed_line.find('\t');
+        batch.sentences.push_back(tab_pos == std::string_view::npos ? std::string_view() : trimmed_line.substr(0, tab_pos));
+    }
+    return !batch.lines.empty();
+}
+
+void convert_corpus(const std::string& input_path, const std::string& output_path, const std::string& failed_path, size_t thread_count) {
+    static constexpr size_t batch_size = 16384;
+    static constexpr size_t buffer_size = 1024 * 1024;
+
+    std::vector<char> input_buffer(buffer_size);
+    std::ifstream input;
+    input.rdbuf()->pubsetbuf(input_buffer.data(), input_buffer.size());
+    input.open(input_path);
+    if (!input.is_open()) {
+        throw std::runtime_error("Failed to open " + input_path);
+    }
+
+    std::vector<char> output_buffer(buffer_size);
+    std::ofstream output;
+    output.rdbuf()->pubsetbuf(output_buffer.data(), output_buffer.size());
+    output.open(output_path);
+    if (!output.is_open()) {
+        throw std::runtime_error("Failed to open " + output_path);
+    }
+
+    std::ofstream failed;
+    if (!failed_path.empty()) {
+        failed.open(failed_path);
+        if (!failed.is_open()) {
+            throw std::runtime_error("Failed to open " + failed_path);
+        }
+    }
+
+    WorkerPool pool(thread_count);
+    size_t line_count = 0;
+    size_t converted_count = 0;
+    size_t failed_count = 0;
+    auto start_time = std::chrono::steady_clock::now();
+    auto sentences_per_second = [&start_time](size_t count) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        return elapsed.count() > 0. ? (size_t) (count / elapsed.count()) : count;
+    };
+
+    // While one batch is being analyzed, the previous one is written out and the next one is read in
+    CorpusBatch current_batch;
+    CorpusBatch next_batch;
+    bool has_current_batch = read_corpus_batch(input, current_batch, 1, batch_size);
+    while (has_current_batch) {
+        auto analysis = std::async(std::launch::async, [&pool, &current_batch]() {
+            analyze_sentences(pool, current_batch.sentences, current_batch.output_sentences);
+        });
+        bool has_next_batch = read_corpus_batch(input, next_batch, current_batch.first_line + current_batch.lines.size(), batch_size);
+        analysis.get();
+
+        for (size_t i = 0; i < current_batch.lines.size(); ++i) {
+            std::string_view trimmed_line = trim(current_batch.lines[i]);
+            if (trimmed_line.empty()) {
+                continue;
+            }
+
+            if (current_batch.output_sentences[i]) {
+                // Only the English (the second column) is kept, like datagen.py does
+                std::string_view english = trimmed_line.substr(current_batch.sentences[i].size() + 1);
+                output << *current_batch.output_sentences[i] << '\t' << english.substr(0, english.find('\t')) << '\n';
+                ++converted_count;
+            } else {
+                if (failed.is_open()) {
+                    failed << current_batch.first_line + i << '\t' << trimmed_line << '\n';
+                } else {
+                    std::cerr << "Warning: The following sentence could not be converted to IR (line " << current_batch.first_line + i << "): " << current_batch.sentences[i] << std::endl;
+                }
+                ++failed_count;
+            }
+        }
+        line_count += current_batch.lines.size();
+        std::cout << "Done with " << converted_count + failed_count << " sentence pairs (" << sentences_per_second(converted_count + failed_count) << " sentences/s)" << std::endl;
+
+        std::swap(current_batch, next_batch);
+        has_current_batch = has_next_batch;
+    }
+
+    output.close();
+    if (!output) {
+        throw std::runtime_error("Failed to write " + output_path);
+    }
+    if (failed.is_open()) {
+        failed.close();
+        if (!failed) {
+            throw std::runtime_error("Failed to write " + failed_path);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cout << "Converted " << converted_count << '/' << converted_count + failed_count << " sentence pairs from " << line_count << " lines in " << elapsed.count() << "s (" << sentences_per_second(converted_count + failed_count) << " sentences/s)" << std::endl;
+    if (failed_count) {
+        std::cout << failed_count << " sentence pairs could not be converted" << (!failed_path.empty() ? " and were written to " + failed_path : std::string()) << std::endl;
+    }
+}
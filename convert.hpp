@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <thread>
+
+// Converts a tab-separated Latin/English corpus into IR/English pairs, like datagen.py but without the HTTP round trips
+// Lines that can't be converted are skipped, and listed in the failed file (or on stderr if there isn't one)
+// Throws std::runtime_error if a file can't be opened
+void convert_corpus(const std::string& input_path, const std::string& output_path, const std::string& failed_path = {}, size_t thread_count = std::thread::hardware_concurrency());
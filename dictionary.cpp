@@ -1,177 +1,558 @@
 #include "dictionary.hpp"
 #include "Polyweb/string.hpp"
+#include "analyzer.hpp"
+#include "lexicon.hpp"
+#include "metrics.hpp"
+#include "whitakers_words.hpp"
 #include "words.hpp"
 #include <algorithm>
-#include <boost/process.hpp>
+#include <charconv>
 #include <ctype.h>
+#include <iostream>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <ostream>
-#include <regex>
-#include <sstream>
-#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
 
 // These dictionary entries are some of my own, and when any are found for a given word, they take precedence over all of Whitaker's entries.
 // Some of these exist because I disagree with Whitaker's definitions, and others exist because some of Whitaker's entries are unparseable.
-const std::unordered_multimap<std::string, const WordVariant, pw::string::CaseInsensitiveHasher, pw::string::CaseInsensitiveComparer> internal_dictionary = {
+const WordVariant internal_dictionary[] = {
+    // quid
     {
-        "quid",
-        {
-            .forms = {
-                std::make_shared<Pronoun>(1, CASUS_NOMINATIVE, false, GENDER_NEUTER),
-                std::make_shared<Pronoun>(1, CASUS_ACCUSATIVE, false, GENDER_NEUTER),
-            },
-            .english_base = "what",
-            .definition = "what",
+        .forms = {
+            WordForm::make_pronoun(1, CASUS_NOMINATIVE, false, GENDER_NEUTER),
+            WordForm::make_pronoun(1, CASUS_ACCUSATIVE, false, GENDER_NEUTER),
         },
+        .english_base = "what",
+        .definition = "what",
     },
+    // de
     {
-        "de",
-        {
-            .forms = {
-                std::make_shared<Preposition>(CASUS_ABLATIVE),
-            },
-            .english_base = "down",
-            .definition = "down",
+        .forms = {
+            WordForm::make_preposition(CASUS_ABLATIVE),
         },
+        .english_base = "down",
+        .definition = "down",
     },
+    // de
     {
-        "de",
-        {
-            .forms = {
-                std::make_shared<Preposition>(CASUS_ABLATIVE),
-            },
-            .english_base = "about",
-            .definition = "about",
+        .forms = {
+            WordForm::make_preposition(CASUS_ABLATIVE),
         },
+        .english_base = "about",
+        .definition = "about",
     },
+    // a
     {
-        "a",
-        {
-            .forms = {
-                std::make_shared<Preposition>(CASUS_ABLATIVE),
-            },
-            .english_base = "by",
-            .definition = "by",
+        .forms = {
+            WordForm::make_preposition(CASUS_ABLATIVE),
         },
+        .english_base = "by",
+        .definition = "by",
     },
+    // a
     {
-        "a",
-        {
-            .forms = {
-                std::make_shared<Preposition>(CASUS_ACCUSATIVE),
-            },
-            .english_base = "before",
-            .definition = "before",
+        .forms = {
+            WordForm::make_preposition(CASUS_ACCUSATIVE),
         },
+        .english_base = "before",
+        .definition = "before",
     },
+    // a
     {
-        "a",
-        {
-            .forms = {
-                std::make_shared<Interjection>(),
-            },
-            .english_base = "Ah",
-            .definition = "Ah",
+        .forms = {
+            WordForm::make_interjection(),
         },
+        .english_base = "Ah",
+        .definition = "Ah",
     },
+    // pro
     {
-        "pro",
-        {
-            .forms = {
-                std::make_shared<Preposition>(CASUS_ABLATIVE),
-            },
-            .english_base = "for",
-            .definition = "for",
+        .forms = {
+            WordForm::make_preposition(CASUS_ABLATIVE),
         },
+        .english_base = "for",
+        .definition = "for",
     },
+    // unumquodque
     {
-        "unumquodque",
-        {
-            .forms = {
-                std::make_shared<Pronoun>(0, CASUS_NOMINATIVE, false, GENDER_NEUTER),
-                std::make_shared<Pronoun>(0, CASUS_ACCUSATIVE, false, GENDER_NEUTER),
-            },
-            .english_base = "each one",
-            .definition = "each one",
+        .forms = {
+            WordForm::make_pronoun(0, CASUS_NOMINATIVE, false, GENDER_NEUTER),
+            WordForm::make_pronoun(0, CASUS_ACCUSATIVE, false, GENDER_NEUTER),
         },
+        .english_base = "each one",
+        .definition = "each one",
     },
+    // rapide
     {
-        "rapide",
-        {
-            .forms = {
-                std::make_shared<Adjective>(1, CASUS_VOCATIVE, false, GENDER_MASCULINE, DEGREE_POSITIVE),
-            },
-            .english_base = "rapid",
-            .definition = "rapid",
+        .forms = {
+            WordForm::make_adjective(1, CASUS_VOCATIVE, false, GENDER_MASCULINE, DEGREE_POSITIVE),
         },
+        .english_base = "rapid",
+        .definition = "rapid",
     },
+    // rapide
     {
-        "rapide",
-        {
-            .forms = {
-                std::make_shared<Adverb>(DEGREE_POSITIVE),
-            },
-            .english_base = "rapidly",
-            .definition = "rapidly",
+        .forms = {
+            WordForm::make_adverb(DEGREE_POSITIVE),
         },
+        .english_base = "rapidly",
+        .definition = "rapidly",
     },
 };
 
-struct WhitakersWords {
-    boost::process::ipstream out;
-    boost::process::opstream in;
-    boost::process::child child;
+// The word that each entry above is for, in the same order, with entries for the same word next to each other
+constexpr std::string_view internal_words[] = {
+    "quid",
+    "de",
+    "de",
+    "a",
+    "a",
+    "a",
+    "pro",
+    "unumquodque",
+    "rapide",
+    "rapide",
+};
+static_assert(std::size(internal_words) == std::size(internal_dictionary), "Every internal dictionary entry must have a word");
+
+constexpr bool internal_words_are_grouped() {
+    for (size_t i = 1; i < std::size(internal_words); ++i) {
+        if (internal_words[i] != internal_words[i - 1]) {
+            for (size_t j = 0; j + 1 < i; ++j) {
+                if (internal_words[j] == internal_words[i]) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+static_assert(internal_words_are_grouped(), "Internal dictionary entries for the same word must be next to each other");
+
+// Case-insensitive for ASCII letters, which is all that query_dictionary lets through
+constexpr uint32_t hash_internal_word(std::string_view word, uint32_t seed) {
+    uint32_t ret = seed ^ 2166136261;
+    for (char c : word) {
+        ret = (ret ^ (c | 0x20)) * 16777619;
+    }
+    return ret;
+}
+
+constexpr bool internal_words_equal(std::string_view word, std::string_view internal_word) {
+    if (word.size() != internal_word.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < word.size(); ++i) {
+        if ((word[i] | 0x20) != internal_word[i]) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    WhitakersWords(const std::string& binary = "bin/words", std::string_view start_dir = "whitakers-words"):
-        child(binary, boost::process::start_dir(start_dir), boost::process::std_out > out, boost::process::std_in < in) {}
+// A perfect hash table from each distinct word to its entries, found by trying seeds until no two words collide
+struct InternalIndex {
+    struct Slot {
+        uint8_t begin = 0;
+        uint8_t end = 0;
+    };
+
+    uint32_t seed = 0;
+    Slot slots[32];
 };
+static_assert(std::size(internal_words) <= UINT8_MAX, "Internal dictionary entries must be indexable by a uint8_t");
+
+constexpr InternalIndex make_internal_index() {
+    for (uint32_t seed = 0;; ++seed) {
+        InternalIndex ret;
+        ret.seed = seed;
+
+        bool collided = false;
+        for (size_t i = 0; i < std::size(internal_words) && !collided; ++i) {
+            if (i && internal_words[i] == internal_words[i - 1]) {
+                ++ret.slots[hash_internal_word(internal_words[i], seed) % std::size(ret.slots)].end;
+                continue;
+            }
 
-std::string Transliterator::operator()(std::string_view str) {
+            auto& slot = ret.slots[hash_internal_word(internal_words[i], seed) % std::size(ret.slots)];
+            if (slot.begin != slot.end) {
+                collided = true;
+            } else {
+                slot.begin = i;
+                slot.end = i + 1;
+            }
+        }
+        if (!collided) {
+            return ret;
+        }
+    }
+}
+
+constexpr InternalIndex internal_index = make_internal_index();
+
+std::unique_ptr<const Lexicon> lexicon;
+std::unique_ptr<const Analyzer> analyzer;
+std::unique_ptr<WhitakersWordsPool> whitakers_words;
+std::once_flag whitakers_words_once;
+std::string whitakers_words_start_dir;
+bool whitakers_words_fallback = false; // Whether to start a small pool once the in-process backend misses a word
+LRUCache<std::string, std::shared_ptr<const std::vector<WordVariant>>> dictionary_cache(64 * 1024 * 1024);
+
+// ASCII foldings of U+00C0 to U+024F, which cover the accented letters of Latin-1 and Latin Extended-A and B, macrons and breves included
+// Code points without a folding are left to iconv
+const char* const latin_foldings[0x250 - 0xC0] = {
+    "A", "A", "A", "A", "A", "A", "AE", "C", "E", "E", "E", "E", "I", "I", "I", "I",                                                            // U+00C0
+    "D", "N", "O", "O", "O", "O", "O", nullptr, "O", "U", "U", "U", "U", "Y", "TH", "ss",                                                       // U+00D0
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",                                                            // U+00E0
+    "d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "y",                                                        // U+00F0
+    "A", "a", "A", "a", "A", "a", "C", "c", "C", "c", "C", "c", "C", "c", "D", "d",                                                             // U+0100
+    "D", "d", "E", "e", "E", "e", "E", "e", "E", "e", "E", "e", "G", "g", "G", "g",                                                             // U+0110
+    "G", "g", "G", "g", "H", "h", "H", "h", "I", "i", "I", "i", "I", "i", "I", "i",                                                             // U+0120
+    "I", "i", "IJ", "ij", "J", "j", "K", "k", nullptr, "L", "l", "L", "l", "L", "l", nullptr,                                                   // U+0130
+    nullptr, "L", "l", "N", "n", "N", "n", "N", "n", nullptr, nullptr, nullptr, "O", "o", "O", "o",                                             // U+0140
+    "O", "o", "OE", "oe", "R", "r", "R", "r", "R", "r", "S", "s", "S", "s", "S", "s",                                                           // U+0150
+    "S", "s", "T", "t", "T", "t", "T", "t", "U", "u", "U", "u", "U", "u", "U", "u",                                                             // U+0160
+    "U", "u", "U", "u", "W", "w", "Y", "y", "Y", "Z", "z", "Z", "z", "Z", "z", "s",                                                             // U+0170
+    "b", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, // U+0180
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "I", nullptr, nullptr, "l", nullptr, nullptr, nullptr, nullptr, nullptr,     // U+0190
+    "O", "o", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "U",         // U+01A0
+    "u", nullptr, nullptr, nullptr, nullptr, "Z", "z", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,         // U+01B0
+    nullptr, nullptr, nullptr, nullptr, "DZ", "Dz", "dz", "LJ", "Lj", "lj", "NJ", "Nj", "nj", "A", "a", "I",                                    // U+01C0
+    "i", "O", "o", "U", "u", "U", "u", "U", "u", "U", "u", "U", "u", nullptr, "A", "a",                                                         // U+01D0
+    "A", "a", "AE", "ae", nullptr, nullptr, "G", "g", "K", "k", "O", "o", "O", "o", nullptr, nullptr,                                           // U+01E0
+    "j", "DZ", "Dz", "dz", "G", "g", nullptr, nullptr, "N", "n", "A", "a", "AE", "ae", "O", "o",                                                // U+01F0
+    "A", "a", "A", "a", "E", "e", "E", "e", "I", "i", "I", "i", "O", "o", "O", "o",                                                             // U+0200
+    "R", "r", "R", "r", "U", "u", "U", "u", "S", "s", "T", "t", nullptr, nullptr, "H", "h",                                                     // U+0210
+    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "A", "a", "E", "e", "O", "o", "O", "o", "O", "o",                                     // U+0220
+    "O", "o", "Y", "y", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "A", "C", "c", nullptr, "T", nullptr,                             // U+0230
+    nullptr, nullptr, nullptr, "B", nullptr, nullptr, "E", "e", "J", "j", nullptr, nullptr, "R", "r", "Y", "y",                                 // U+0240
+};
+
+void Transliterator::operator()(std::string_view str, std::string& ret) {
+    StageTimer timer(STAGE_TRANSLITERATION);
+    if (std::all_of(str.begin(), str.end(), [](char c) {
+            return !(c & 0x80);
+        })) {
+        ret.assign(str);
+        return;
+    }
+
+    ret.clear();
+    for (size_t i = 0; i < str.size();) {
+        unsigned char c = str[i];
+        if (c < 0x80) {
+            ret.push_back(c);
+            ++i;
+            continue;
+        }
+
+        // Decode the code point, replacing malformed sequences with question marks, like iconv does with unknown characters
+        size_t length;
+        uint32_t code_point;
+        if (c >= 0xC0 && c < 0xE0) {
+            length = 2;
+            code_point = c & 0x1F;
+        } else if (c >= 0xE0 && c < 0xF0) {
+            length = 3;
+            code_point = c & 0x0F;
+        } else if (c >= 0xF0 && c < 0xF8) {
+            length = 4;
+            code_point = c & 0x07;
+        } else {
+            ret.push_back('?');
+            ++i;
+            continue;
+        }
+        size_t j;
+        for (j = 1; j < length && i + j < str.size() && (str[i + j] & 0xC0) == 0x80; ++j) {
+            code_point = (code_point << 6) | (str[i + j] & 0x3F);
+        }
+        if (j != length) {
+            ret.push_back('?');
+            i += j;
+            continue;
+        }
+
+        if (code_point >= 0x300 && code_point < 0x370) {
+            // Combining diacritics are dropped
+        } else if (code_point >= 0xC0 && code_point < 0x250 && latin_foldings[code_point - 0xC0]) {
+            ret += latin_foldings[code_point - 0xC0];
+        } else {
+            fold_with_iconv(str.substr(i, length), ret);
+        }
+        i += length;
+    }
+}
+
+void Transliterator::fold_with_iconv(std::string_view character, std::string& ret) {
     locale_t old_locale = uselocale(us_locale);
 
-    char input[str.size()];
-    memcpy(input, str.data(), str.size());
+    char input[4];
+    memcpy(input, character.data(), character.size());
     char* input_ptr = input;
-    size_t input_size = str.size();
+    size_t input_size = character.size();
 
-    char output[str.size()];
+    char output[16];
     char* output_ptr = output;
-    size_t output_size = str.size();
+    size_t output_size = sizeof(output);
 
-    assert(iconv(cd, &input_ptr, &input_size, &output_ptr, &output_size) != (size_t) -1);
+    if (iconv(cd, &input_ptr, &input_size, &output_ptr, &output_size) == (size_t) -1) {
+        iconv(cd, nullptr, nullptr, nullptr, nullptr); // Reset the conversion state
+        ret.push_back('?');
+    } else {
+        ret.append(output, output_ptr);
+    }
 
     uselocale(old_locale);
-    return std::string(output, output_ptr);
 }
 
-size_t query_dictionary(const std::string& word, std::vector<WordVariant>& ret) {
-    for (char c : word) {
-        if (!isalpha(c)) {
-            return 0;
+PartOfSpeech parse_part_of_speech(std::string_view str) {
+    switch (hash(str)) {
+    case hash("N"): return PART_OF_SPEECH_NOUN;
+    case hash("V"): return PART_OF_SPEECH_VERB;
+    case hash("VPAR"): return PART_OF_SPEECH_PARTICIPLE;
+    case hash("SUPINE"): return PART_OF_SPEECH_SUPINE;
+    case hash("ADJ"): return PART_OF_SPEECH_ADJECTIVE;
+    case hash("ADV"): return PART_OF_SPEECH_ADVERB;
+    case hash("PRON"):
+    case hash("PACK"): return PART_OF_SPEECH_PRONOUN;
+    case hash("CONJ"): return PART_OF_SPEECH_CONJUNCTION;
+    case hash("PREP"): return PART_OF_SPEECH_PREPOSITION;
+    case hash("INTERJ"): return PART_OF_SPEECH_INTERJECTION;
+    case hash("NUM"): return PART_OF_SPEECH_NUMERAL;
+    default: throw std::runtime_error("Invalid part of speech");
+    }
+}
+
+Casus parse_casus(std::string_view str) {
+    switch (hash(str)) {
+    case hash("NOM"):
+    case hash("X"): return CASUS_NOMINATIVE;
+    case hash("GEN"): return CASUS_GENITIVE;
+    case hash("DAT"): return CASUS_DATIVE;
+    case hash("ACC"): return CASUS_ACCUSATIVE;
+    case hash("ABL"): return CASUS_ABLATIVE;
+    case hash("VOC"): return CASUS_VOCATIVE;
+    case hash("LOC"): return CASUS_LOCATIVE;
+    default: throw std::runtime_error("Invalid case");
+    }
+}
+
+Gender parse_gender(char c) {
+    switch (c) {
+    case 'M': return GENDER_MASCULINE;
+    case 'F': return GENDER_FEMININE;
+    case 'N': return GENDER_NEUTER;
+    case 'C':
+    case 'X': return GENDER_COMMON;
+    default: throw std::runtime_error("Invalid gender");
+    }
+}
+
+Tense parse_tense(std::string_view str) {
+    switch (hash(str)) {
+    case hash("PRES"):
+    case hash("X"): return TENSE_PRESENT;
+    case hash("IMPF"): return TENSE_IMPERFECT;
+    case hash("PERF"): return TENSE_PERFECT;
+    case hash("PLUP"): return TENSE_PLUPERFECT;
+    case hash("FUT"): return TENSE_FUTURE;
+    case hash("FUTP"): return TENSE_FUTURE_PERFECT;
+    default: throw std::runtime_error("Invalid tense");
+    }
+}
+
+Voice parse_voice(std::string_view str) {
+    switch (hash(str)) {
+    case hash("PASSIVE"): return VOICE_PASSIVE;
+    default: return VOICE_ACTIVE;
+    }
+}
+
+Mood parse_mood(std::string_view str) {
+    switch (hash(str)) {
+    case hash("IND"):
+    case hash("X"): return MOOD_INDICATIVE;
+    case hash("SUB"): return MOOD_SUBJUNCTIVE;
+    case hash("IMP"): return MOOD_IMPERATIVE;
+    case hash("INF"): return MOOD_INFINITIVE;
+    default: throw std::runtime_error("Invalid mood");
+    }
+}
+
+Degree parse_degree(std::string_view str) {
+    switch (hash(str)) {
+    case hash("POS"): return DEGREE_POSITIVE;
+    case hash("COMP"): return DEGREE_COMPARATIVE;
+    case hash("SUPER"): return DEGREE_SUPERLATIVE;
+    case hash("X"): return DEGREE_NONE;
+    default: throw std::runtime_error("Invalid degree of comparison");
+    }
+}
+
+NumeralType parse_numeral_type(std::string_view str) {
+    switch (hash(str)) {
+    case hash("CARD"): return NUMERAL_TYPE_CARDINAL;
+    case hash("ORD"): return NUMERAL_TYPE_ORDINAL;
+    case hash("DIST"): return NUMERAL_TYPE_DISTRIBUTIVE;
+    case hash("ADVERB"): return NUMERAL_TYPE_ADVERB;
+    case hash("X"): return NUMERAL_TYPE_NONE;
+    default: throw std::runtime_error("Invalid numeral type");
+    }
+}
+
+void strip_comments(std::string_view line, std::string& ret) {
+    ret.clear();
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '(' || line[i] == '[') {
+            char close = line[i] == '(' ? ')' : ']';
+            size_t end = line.find_first_of(std::string {line[i], close}, i + 1);
+            if (end != std::string_view::npos && line[end] == close) {
+                i = end;
+                continue;
+            }
+        }
+        ret.push_back(line[i]);
+    }
+}
+
+std::string find_english_base(std::string_view definition) {
+    std::string ret;
+    std::string first_english_base;
+
+    bool eof = false;
+    size_t i = 0;
+    do {
+        ret.clear();
+        for (; i < definition.size() && !ispunct(definition[i]); ++i) {
+            ret.push_back(definition[i]);
+        }
+        if (i < definition.size()) {
+            ++i; // Skip punctuation
+        } else {
+            eof = true;
+        }
+
+        pw::string::trim(ret);
+        if (first_english_base.empty() && !ret.empty()) {
+            first_english_base = ret;
         }
+    } while (!eof && (ret == "etc" ||
+                         std::find_if(ret.begin(), ret.end(), isspace) != ret.end()));
+
+    if (ret.empty()) {
+        return first_english_base;
     }
+    return ret;
+}
 
-    auto range = internal_dictionary.equal_range(word);
-    if (range.first != range.second) {
-        std::transform(range.first, range.second, std::back_inserter(ret), [](const auto& entry) {
-            return entry.second;
-        });
-        return ret.size();
+DictionaryBackend init_dictionary(const std::string& whitakers_words_directory, const std::string& lexicon_path) {
+    DictionaryBackend ret = DICTIONARY_BACKEND_WHITAKERS_WORDS;
+    try {
+        lexicon = std::make_unique<const Lexicon>(lexicon_path);
+        ret = DICTIONARY_BACKEND_LEXICON;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Warning: Failed to load lexicon: " << e.what() << std::endl;
     }
 
-    thread_local WhitakersWords words;
-    words.out.ignore(std::numeric_limits<std::streamsize>::max(), '>'); // Reset state
-    words.in << word << std::endl;
+    if (ret == DICTIONARY_BACKEND_WHITAKERS_WORDS) {
+        try {
+            analyzer = std::make_unique<const Analyzer>(whitakers_words_directory);
+            ret = DICTIONARY_BACKEND_ANALYZER;
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Warning: Failed to load analyzer: " << e.what() << std::endl;
+        }
+    }
 
-    bool last_line_empty = false;
-    for (WordVariant variant; words.out;) {
-        std::string original_line;
-        std::getline(words.out, original_line);
-        pw::string::trim_right(original_line);
+    // The in-process backends don't implement suffixes, tackons other than -que, -cum, and -ne, or tricks, so their misses are sent to Whitaker's Words itself if it's there
+    if (ret == DICTIONARY_BACKEND_WHITAKERS_WORDS) {
+        whitakers_words = std::make_unique<WhitakersWordsPool>(whitakers_words_directory);
+    } else if (access((whitakers_words_directory + "/bin/words").c_str(), X_OK) == 0) {
+        whitakers_words_start_dir = whitakers_words_directory;
+        whitakers_words_fallback = true;
+    } else {
+        std::cerr << "Warning: " << whitakers_words_directory << "/bin/words not found, so words that need suffixes, rarer tackons, or tricks to analyze won't be found" << std::endl;
+    }
+    return ret;
+}
 
-        static std::regex comments_re("(\\([^\\(\\)]*\\))|(\\[[^\\[\\]]*\\])", std::regex_constants::optimize);
-        std::string line = std::regex_replace(original_line, comments_re, "");
+size_t estimate_size(const std::string& word, const std::vector<WordVariant>& variants) {
+    size_t ret = sizeof(std::string) + word.capacity() + sizeof(variants) + variants.capacity() * sizeof(WordVariant);
+    for (const auto& variant : variants) {
+        ret += variant.english_base.capacity() + variant.definition.capacity() + variant.breakdown.capacity();
+        ret += variant.forms.capacity() * sizeof(WordForm);
+    }
+    return ret;
+}
+
+// Splits the next whitespace-separated field off the front of a line
+std::string_view next_field(std::string_view& line) {
+    size_t begin = 0;
+    while (begin < line.size() && isspace(line[begin])) {
+        ++begin;
+    }
+    size_t end = begin;
+    while (end < line.size() && !isspace(line[end])) {
+        ++end;
+    }
+
+    std::string_view ret = line.substr(begin, end - begin);
+    line.remove_prefix(end);
+    return ret;
+}
+
+// Splits the next non-whitespace character off the front of a line, returning 0 at the end of the line
+char next_char(std::string_view& line) {
+    while (!line.empty() && isspace(line.front())) {
+        line.remove_prefix(1);
+    }
+    if (line.empty()) {
+        return 0;
+    }
+
+    char ret = line.front();
+    line.remove_prefix(1);
+    return ret;
+}
+
+// Fields that aren't numbers are read as 0
+unsigned short next_number(std::string_view& line) {
+    std::string_view field = next_field(line);
+    unsigned short ret;
+    if (std::from_chars(field.data(), field.data() + field.size(), ret).ec != std::errc()) {
+        return 0;
+    }
+    return ret;
+}
+
+// Whether a breakdown like "am.o" spells out the word, ignoring case
+bool breakdown_matches(std::string_view breakdown, std::string_view word) {
+    size_t i = 0;
+    for (char c : breakdown) {
+        if (c != '.' && (i == word.size() || tolower(c) != tolower(word[i++]))) {
+            return false;
+        }
+    }
+    return i == word.size();
+}
+
+size_t parse_whitakers_words(const std::string& word, std::string_view output, std::vector<WordVariant>& ret) {
+    std::string line;
+    bool last_line_empty = false;
+    WordVariant variant;
+    for (size_t line_begin = 0, line_end; line_begin < output.size(); line_begin = line_end + 1) {
+        if ((line_end = output.find('\n', line_begin)) == std::string_view::npos) {
+            line_end = output.size();
+        }
+        std::string_view original_line = output.substr(line_begin, line_end - line_begin);
+        while (!original_line.empty() && isspace(original_line.back())) {
+            original_line.remove_suffix(1);
+        }
+        strip_comments(original_line, line);
 
         if (line.empty() && last_line_empty) {
             break;
@@ -179,45 +560,21 @@ size_t query_dictionary(const std::string& word, std::vector<WordVariant>& ret)
                    line == "Two words" ||
                    pw::string::ends_with(line, "UNKNOWN")) {
             break;
-        } else if (pw::string::ends_with(line, "MORE - hit RETURN/ENTER to continue")) {
-            words.in << std::endl;
-            continue;
-        } else if ((line.front() == ' ' && (line.size() < 2 || !isdigit(line[1]))) || line.front() == '-') {
+        } else if (!line.empty() && ((line.front() == ' ' && (line.size() < 2 || !isdigit(line[1]))) || line.front() == '-')) {
             continue;
         }
         last_line_empty = line.empty() || line.front() == '*';
 
-        std::istringstream ss(line);
-
-        std::string breakdown;
-        ss >> breakdown;
-        std::string first_word = breakdown;
-        first_word.erase(std::remove(first_word.begin(), first_word.end(), '.'), first_word.end());
-        if (!pw::string::iequals(first_word, word)) {
+        std::string_view fields = line;
+        std::string_view breakdown = next_field(fields);
+        if (!breakdown_matches(breakdown, word)) {
             if (!variant.forms.empty() && std::find_if(line.begin(), line.end(), ispunct) != line.end()) {
                 variant.definition = original_line;
-
-                std::string first_english_base;
-
-                ss.seekg(0);
-                do {
-                    variant.english_base.clear();
-                    for (char c; ss.get(c) && !ispunct(c);) {
-                        variant.english_base.push_back(c);
-                    }
-
-                    pw::string::trim(variant.english_base);
-                    if (first_english_base.empty() && !variant.english_base.empty()) {
-                        first_english_base = variant.english_base;
-                    }
-                } while (ss && (variant.english_base == "etc" ||
-                                   std::find_if(variant.english_base.begin(), variant.english_base.end(), isspace) != variant.english_base.end()));
+                variant.english_base = find_english_base(line);
 
                 if (!variant.english_base.empty()) {
                     ret.push_back(std::move(variant));
-                } else if (!first_english_base.empty()) {
-                    variant.english_base = first_english_base;
-                    ret.push_back(std::move(variant));
+                    variant = WordVariant();
                 }
             }
             continue;
@@ -225,370 +582,279 @@ size_t query_dictionary(const std::string& word, std::vector<WordVariant>& ret)
             variant.breakdown = breakdown;
         }
 
-        std::string string_part_of_speech;
-        ss >> string_part_of_speech;
-        int unknown;
+        std::string_view string_part_of_speech = next_field(fields);
         switch (hash(string_part_of_speech)) {
         case hash("N"):
         case hash("PRON"): {
-            Declension declension;
-            std::string string_case;
-            char char_plurality;
-            char char_gender;
-            ss >> declension >> unknown >> string_case >> char_plurality >> char_gender;
-
-            // Parse case
-            Casus casus;
-            switch (hash(string_case)) {
-            case hash("NOM"):
-            case hash("X"): casus = CASUS_NOMINATIVE; break;
-            case hash("GEN"): casus = CASUS_GENITIVE; break;
-            case hash("DAT"): casus = CASUS_DATIVE; break;
-            case hash("ACC"): casus = CASUS_ACCUSATIVE; break;
-            case hash("ABL"): casus = CASUS_ABLATIVE; break;
-            case hash("VOC"): casus = CASUS_VOCATIVE; break;
-            case hash("LOC"): casus = CASUS_LOCATIVE; break;
-            default: throw std::runtime_error("Invalid case");
-            }
-
-            // Parse plurality
-            bool plural = char_plurality == 'P';
-
-            // Parse gender
-            Gender gender;
-            switch (char_gender) {
-            case 'M': gender = GENDER_MASCULINE; break;
-            case 'F': gender = GENDER_FEMININE; break;
-            case 'N': gender = GENDER_NEUTER; break;
-            case 'C':
-            case 'X': gender = GENDER_COMMON; break;
-            default: throw std::runtime_error("Invalid gender");
-            }
+            Declension declension = next_number(fields);
+            next_field(fields);
+            Casus casus = parse_casus(next_field(fields));
+            bool plural = next_char(fields) == 'P';
+            Gender gender = parse_gender(next_char(fields));
 
             if (string_part_of_speech == "N") {
-                variant.forms.push_back(std::make_shared<Noun>(declension, casus, plural, gender));
-            } else if (string_part_of_speech == "PRON") {
-                variant.forms.push_back(std::make_shared<Pronoun>(declension, casus, plural, gender));
+                variant.forms.push_back(WordForm::make_noun(declension, casus, plural, gender));
             } else {
-                throw std::logic_error("Invalid part of speech");
+                variant.forms.push_back(WordForm::make_pronoun(declension, casus, plural, gender));
             }
             break;
         }
 
         case hash("V"): {
-            Conjugation conjugation;
-            std::string string_tense;
-            std::string string_voice_or_mood;
-            std::string string_mood;
-            Person person;
-            char char_plurality;
-            ss >> conjugation >> unknown >> string_tense >> string_voice_or_mood;
-
-            // Parse tense
-            Tense tense;
-            switch (hash(string_tense)) {
-            case hash("PRES"):
-            case hash("X"): tense = TENSE_PRESENT; break;
-            case hash("IMPF"): tense = TENSE_IMPERFECT; break;
-            case hash("PERF"): tense = TENSE_PERFECT; break;
-            case hash("PLUP"): tense = TENSE_PLUPERFECT; break;
-            case hash("FUT"): tense = TENSE_FUTURE; break;
-            case hash("FUTP"): tense = TENSE_FUTURE_PERFECT; break;
-            default: throw std::runtime_error("Invalid tense");
-            }
-
-            // Parse voice
-            Voice voice;
-            switch (hash(string_voice_or_mood)) {
-            case hash("ACTIVE"):
-                voice = VOICE_ACTIVE;
-                ss >> string_mood >> person >> char_plurality;
-                break;
-
-            case hash("PASSIVE"):
-                voice = VOICE_PASSIVE;
-                ss >> string_mood >> person >> char_plurality;
-                break;
-
-            default:
-                voice = VOICE_ACTIVE;
-                string_mood = std::move(string_voice_or_mood);
-                ss >> person >> char_plurality;
-                break;
-            }
+            Conjugation conjugation = next_number(fields);
+            next_field(fields);
+            Tense tense = parse_tense(next_field(fields));
 
-            // Parse mood
-            Mood mood;
-            switch (hash(string_mood)) {
-            case hash("IND"):
-            case hash("X"): mood = MOOD_INDICATIVE; break;
-            case hash("SUB"): mood = MOOD_SUBJUNCTIVE; break;
-            case hash("IMP"): mood = MOOD_IMPERATIVE; break;
-            case hash("INF"): mood = MOOD_INFINITIVE; break;
-            default: throw std::runtime_error("Invalid mood");
-            }
+            // The voice is left out for deponent verbs and the like, in which case the mood comes first
+            std::string_view string_voice_or_mood = next_field(fields);
+            Voice voice = parse_voice(string_voice_or_mood);
+            Mood mood = parse_mood(string_voice_or_mood == "ACTIVE" || string_voice_or_mood == "PASSIVE" ? next_field(fields) : string_voice_or_mood);
 
             // Limit person
+            Person person = next_number(fields);
             if (person > 0) {
                 --person;
             }
 
-            // Parse plurality
-            bool plural = char_plurality == 'P';
-
-            variant.forms.push_back(std::make_shared<Verb>(conjugation, tense, voice, mood, person, plural));
+            bool plural = next_char(fields) == 'P';
+            variant.forms.push_back(WordForm::make_verb(conjugation, tense, voice, mood, person, plural));
             break;
         }
 
         case hash("VPAR"): {
-            Conjugation conjugation;
-            std::string string_case;
-            char char_plurality;
-            char char_gender;
-            std::string string_tense;
-            std::string string_voice;
-            ss >> conjugation >> unknown >> string_case >> char_plurality >> char_gender >> string_tense >> string_voice;
-
-            // Parse case
-            Casus casus;
-            switch (hash(string_case)) {
-            case hash("NOM"):
-            case hash("X"): casus = CASUS_NOMINATIVE; break;
-            case hash("GEN"): casus = CASUS_GENITIVE; break;
-            case hash("DAT"): casus = CASUS_DATIVE; break;
-            case hash("ACC"): casus = CASUS_ACCUSATIVE; break;
-            case hash("ABL"): casus = CASUS_ABLATIVE; break;
-            case hash("VOC"): casus = CASUS_VOCATIVE; break;
-            case hash("LOC"): casus = CASUS_LOCATIVE; break;
-            default: throw std::runtime_error("Invalid case");
-            }
-
-            // Parse plurality
-            bool plural = char_plurality == 'P';
-
-            // Parse gender
-            Gender gender;
-            switch (char_gender) {
-            case 'M': gender = GENDER_MASCULINE; break;
-            case 'F': gender = GENDER_FEMININE; break;
-            case 'N': gender = GENDER_NEUTER; break;
-            case 'C':
-            case 'X': gender = GENDER_COMMON; break;
-            default: throw std::runtime_error("Invalid gender");
-            }
-
-            // Parse tense
-            Tense tense;
-            switch (hash(string_tense)) {
-            case hash("PRES"): tense = TENSE_PRESENT; break;
-            case hash("IMPF"): tense = TENSE_IMPERFECT; break;
-            case hash("PERF"): tense = TENSE_PERFECT; break;
-            case hash("PLUP"): tense = TENSE_PLUPERFECT; break;
-            case hash("FUT"): tense = TENSE_FUTURE; break;
-            case hash("FUTP"): tense = TENSE_FUTURE_PERFECT; break;
-            default: throw std::runtime_error("Invalid tense");
-            }
-
-            // Parse voice
-            Voice voice;
-            switch (hash(string_voice)) {
-            case hash("ACTIVE"):
-            default: voice = VOICE_ACTIVE; break;
-            case hash("PASSIVE"): voice = VOICE_PASSIVE; break;
-            }
-
-            variant.forms.push_back(std::make_shared<Participle>(conjugation, casus, plural, gender, tense, voice));
+            Conjugation conjugation = next_number(fields);
+            next_field(fields);
+            Casus casus = parse_casus(next_field(fields));
+            bool plural = next_char(fields) == 'P';
+            Gender gender = parse_gender(next_char(fields));
+            Tense tense = parse_tense(next_field(fields));
+            Voice voice = parse_voice(next_field(fields));
+            variant.forms.push_back(WordForm::make_participle(conjugation, casus, plural, gender, tense, voice));
             break;
         }
 
         case hash("SUPINE"): {
-            Conjugation conjugation;
-            std::string string_case;
-            char char_plurality;
-            char char_gender;
-            ss >> conjugation >> unknown >> string_case >> char_plurality >> char_gender;
-
-            // Parse case
-            Casus casus;
-            switch (hash(string_case)) {
-            case hash("NOM"):
-            case hash("X"): casus = CASUS_NOMINATIVE; break;
-            case hash("GEN"): casus = CASUS_GENITIVE; break;
-            case hash("DAT"): casus = CASUS_DATIVE; break;
-            case hash("ACC"): casus = CASUS_ACCUSATIVE; break;
-            case hash("ABL"): casus = CASUS_ABLATIVE; break;
-            case hash("VOC"): casus = CASUS_VOCATIVE; break;
-            case hash("LOC"): casus = CASUS_LOCATIVE; break;
-            default: throw std::runtime_error("Invalid case");
-            }
-
-            // Parse plurality
-            bool plural = char_plurality == 'P';
-
-            // Parse gender
-            Gender gender;
-            switch (char_gender) {
-            case 'M': gender = GENDER_MASCULINE; break;
-            case 'F': gender = GENDER_FEMININE; break;
-            case 'N': gender = GENDER_NEUTER; break;
-            case 'C':
-            case 'X': gender = GENDER_COMMON; break;
-            default: throw std::runtime_error("Invalid gender");
-            }
-
-            variant.forms.push_back(std::make_shared<Supine>(conjugation, casus, plural, gender));
+            Conjugation conjugation = next_number(fields);
+            next_field(fields);
+            Casus casus = parse_casus(next_field(fields));
+            bool plural = next_char(fields) == 'P';
+            Gender gender = parse_gender(next_char(fields));
+            variant.forms.push_back(WordForm::make_supine(conjugation, casus, plural, gender));
             break;
         }
 
         case hash("ADJ"): {
-            Declension declension;
-            std::string string_case;
-            char char_plurality;
-            char char_gender;
-            std::string string_degree;
-            ss >> declension >> unknown >> string_case >> char_plurality >> char_gender >> string_degree;
-
-            // Parse case
-            Casus casus;
-            switch (hash(string_case)) {
-            case hash("NOM"):
-            case hash("X"): casus = CASUS_NOMINATIVE; break;
-            case hash("GEN"): casus = CASUS_GENITIVE; break;
-            case hash("DAT"): casus = CASUS_DATIVE; break;
-            case hash("ACC"): casus = CASUS_ACCUSATIVE; break;
-            case hash("ABL"): casus = CASUS_ABLATIVE; break;
-            case hash("VOC"): casus = CASUS_VOCATIVE; break;
-            case hash("LOC"): casus = CASUS_LOCATIVE; break;
-            default: throw std::runtime_error("Invalid case");
-            }
-
-            // Parse plurality
-            bool plural = char_plurality == 'P';
-
-            // Parse gender
-            Gender gender;
-            switch (char_gender) {
-            case 'M': gender = GENDER_MASCULINE; break;
-            case 'F': gender = GENDER_FEMININE; break;
-            case 'N': gender = GENDER_NEUTER; break;
-            case 'C':
-            case 'X': gender = GENDER_COMMON; break;
-            default: throw std::runtime_error("Invalid gender");
-            }
-
-            // Parse degree
-            Degree degree;
-            switch (hash(string_degree)) {
-            case hash("POS"): degree = DEGREE_POSITIVE; break;
-            case hash("COMP"): degree = DEGREE_COMPARATIVE; break;
-            case hash("SUPER"): degree = DEGREE_SUPERLATIVE; break;
-            default: throw std::runtime_error("Invalid degree of comparison");
-            }
-
-            variant.forms.push_back(std::make_shared<Adjective>(declension, casus, plural, gender, degree));
+            Declension declension = next_number(fields);
+            next_field(fields);
+            Casus casus = parse_casus(next_field(fields));
+            bool plural = next_char(fields) == 'P';
+            Gender gender = parse_gender(next_char(fields));
+            Degree degree = parse_degree(next_field(fields));
+            variant.forms.push_back(WordForm::make_adjective(declension, casus, plural, gender, degree == DEGREE_NONE ? DEGREE_POSITIVE : degree)); // Same as Analyzer::make_form
             break;
         }
 
         case hash("ADV"): {
-            std::string string_degree;
-            ss >> string_degree;
-
-            // Parse degree
-            Degree degree;
-            switch (hash(string_degree)) {
-            case hash("POS"): degree = DEGREE_POSITIVE; break;
-            case hash("COMP"): degree = DEGREE_COMPARATIVE; break;
-            case hash("SUPER"): degree = DEGREE_SUPERLATIVE; break;
-            default: throw std::runtime_error("Invalid degree of comparison");
-            }
-
-            variant.forms.push_back(std::make_shared<Adverb>(degree));
+            Degree degree = parse_degree(next_field(fields));
+            variant.forms.push_back(WordForm::make_adverb(degree == DEGREE_NONE ? DEGREE_POSITIVE : degree));
             break;
         }
 
         case hash("CONJ"): {
-            variant.forms.push_back(std::make_shared<Conjunction>());
+            variant.forms.push_back(WordForm::make_conjunction());
             break;
         }
 
         case hash("PREP"): {
-            std::string string_case;
-            ss >> string_case;
-
-            // Parse case
-            Casus casus;
-            switch (hash(string_case)) {
-            case hash("NOM"):
-            case hash("X"): casus = CASUS_NOMINATIVE; break;
-            case hash("GEN"): casus = CASUS_GENITIVE; break;
-            case hash("DAT"): casus = CASUS_DATIVE; break;
-            case hash("ACC"): casus = CASUS_ACCUSATIVE; break;
-            case hash("ABL"): casus = CASUS_ABLATIVE; break;
-            case hash("VOC"): casus = CASUS_VOCATIVE; break;
-            case hash("LOC"): casus = CASUS_LOCATIVE; break;
-            default: throw std::runtime_error("Invalid case");
-            }
-
-            variant.forms.push_back(std::make_shared<Preposition>(casus));
+            variant.forms.push_back(WordForm::make_preposition(parse_casus(next_field(fields))));
             break;
         }
 
         case hash("INTERJ"): {
-            variant.forms.push_back(std::make_shared<Interjection>());
+            variant.forms.push_back(WordForm::make_interjection());
             break;
         }
 
         case hash("NUM"): {
-            Declension declension;
-            std::string string_case;
-            char char_plurality;
-            char char_gender;
-            std::string string_type;
-            ss >> declension >> unknown >> string_case >> char_plurality >> char_gender >> string_type;
-
-            // Parse case
-            Casus casus;
-            switch (hash(string_case)) {
-            case hash("NOM"):
-            case hash("X"): casus = CASUS_NOMINATIVE; break;
-            case hash("GEN"): casus = CASUS_GENITIVE; break;
-            case hash("DAT"): casus = CASUS_DATIVE; break;
-            case hash("ACC"): casus = CASUS_ACCUSATIVE; break;
-            case hash("ABL"): casus = CASUS_ABLATIVE; break;
-            case hash("VOC"): casus = CASUS_VOCATIVE; break;
-            case hash("LOC"): casus = CASUS_LOCATIVE; break;
-            default: throw std::runtime_error("Invalid case");
-            }
+            Declension declension = next_number(fields);
+            next_field(fields);
+            Casus casus = parse_casus(next_field(fields));
+            bool plural = next_char(fields) == 'P';
+            Gender gender = parse_gender(next_char(fields));
+            NumeralType type = parse_numeral_type(next_field(fields));
+            variant.forms.push_back(WordForm::make_numeral(declension, casus, plural, gender, type == NUMERAL_TYPE_NONE ? NUMERAL_TYPE_CARDINAL : type));
+            break;
+        }
+        }
+    }
 
-            // Parse plurality
-            bool plural = char_plurality == 'P';
-
-            // Parse gender
-            Gender gender;
-            switch (char_gender) {
-            case 'M': gender = GENDER_MASCULINE; break;
-            case 'F': gender = GENDER_FEMININE; break;
-            case 'N': gender = GENDER_NEUTER; break;
-            case 'C':
-            case 'X': gender = GENDER_COMMON; break;
-            default: throw std::runtime_error("Invalid gender");
-            }
+    return ret.size();
+}
 
-            // Parse type
-            NumeralType type;
-            switch (hash(string_type)) {
-            case hash("CARD"): type = NUMERAL_TYPE_CARDINAL; break;
-            case hash("ORD"): type = NUMERAL_TYPE_ORDINAL; break;
-            case hash("DIST"): type = NUMERAL_TYPE_DISTRIBUTIVE; break;
-            case hash("ADVERB"): type = NUMERAL_TYPE_ADVERB; break;
-            default: throw std::runtime_error("Invalid numeral type");
+// Returns nullptr if Whitaker's Words isn't available
+// When it's only a fallback, its processes aren't started until the first word that needs them, and only a couple are started
+WhitakersWordsPool* get_whitakers_words() {
+    static constexpr size_t fallback_process_count = 2;
+
+    if (whitakers_words_fallback) {
+        std::call_once(whitakers_words_once, []() {
+            try {
+                whitakers_words = std::make_unique<WhitakersWordsPool>(whitakers_words_start_dir, fallback_process_count);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Warning: Failed to start Whitaker's Words: " << e.what() << std::endl;
             }
+        });
+    }
+    return whitakers_words.get();
+}
 
-            variant.forms.push_back(std::make_shared<Numeral>(declension, casus, plural, gender, type));
-            break;
+// Returns false if the word's process crashed instead of answering
+bool query_whitakers_words(const std::string& word, std::vector<WordVariant>& ret) {
+    thread_local std::vector<std::string> words(1);
+    thread_local std::vector<std::string> outputs;
+    words.front() = word;
+    get_whitakers_words()->query(words, outputs);
+    if (outputs.front().empty()) {
+        return false;
+    }
+    parse_whitakers_words(word, outputs.front(), ret);
+    return true;
+}
+
+std::pair<const WordVariant*, const WordVariant*> find_internal_variants(std::string_view word) {
+    const auto& slot = internal_index.slots[hash_internal_word(word, internal_index.seed) % std::size(internal_index.slots)];
+    if (slot.begin == slot.end || !internal_words_equal(word, internal_words[slot.begin])) {
+        return {nullptr, nullptr};
+    }
+    return {internal_dictionary + slot.begin, internal_dictionary + slot.end};
+}
+
+// Plain words go before proper nouns (whose English bases are capitalized), and shorter English bases go first
+bool compare_variants(const WordVariant& a, const WordVariant& b) {
+    bool a_has_upper = std::find_if(a.english_base.begin(), a.english_base.end(), isupper) != a.english_base.end();
+    bool b_has_upper = std::find_if(b.english_base.begin(), b.english_base.end(), isupper) != b.english_base.end();
+    if (a_has_upper == b_has_upper) {
+        return a.english_base.size() < b.english_base.size();
+    } else {
+        return b_has_upper;
+    }
+}
+
+// Words that can't be found are cached as this shared empty list, so that unknown words (names, typos, Greek, etc.) are only looked up once
+const std::shared_ptr<const std::vector<WordVariant>> unknown_word = std::make_shared<const std::vector<WordVariant>>();
+
+// Answers a query from the built-in entries or the cache, if possible
+// ret is left empty for words that are known not to be in the dictionary
+bool find_known_variants(const std::string& word, VariantsView& ret) {
+    auto range = find_internal_variants(word);
+    if (range.first != range.second) {
+        ret = VariantsView(range.first, range.second);
+        return true;
+    }
+
+    std::shared_ptr<const std::vector<WordVariant>> variants;
+    if (dictionary_cache.get(word, variants)) {
+        ret = VariantsView(std::move(variants));
+        return true;
+    }
+    return false;
+}
+
+// Returns false if there's no in-process backend or it couldn't find the word
+bool look_up_variants_in_process(const std::string& word, std::vector<WordVariant>& ret) {
+    if (lexicon) {
+        lexicon->lookup(word, ret);
+    } else if (analyzer) {
+        analyzer->analyze(word, ret);
+    }
+    return !ret.empty();
+}
+
+// Returns false if the backend failed to answer, in which case nothing should be cached
+bool look_up_variants(const std::string& word, std::vector<WordVariant>& ret) {
+    if (look_up_variants_in_process(word, ret) || !get_whitakers_words()) {
+        return true;
+    }
+    StageTimer subprocess_timer(STAGE_SUBPROCESS_WAIT);
+    return query_whitakers_words(word, ret);
+}
+
+// Sorts freshly looked up variants and adds them to the cache
+bool cache_variants(const std::string& word, std::vector<WordVariant>& new_variants, VariantsView& ret) {
+    if (new_variants.empty()) {
+        dictionary_cache.put(word, unknown_word, estimate_size(word, *unknown_word));
+        return false;
+    }
+    std::sort(new_variants.begin(), new_variants.end(), compare_variants);
+
+    size_t size = estimate_size(word, new_variants);
+    auto variants = std::make_shared<const std::vector<WordVariant>>(std::move(new_variants));
+    dictionary_cache.put(word, variants, size);
+    ret = VariantsView(std::move(variants));
+    return true;
+}
+
+bool query_dictionary(const std::string& word, VariantsView& ret) {
+    StageTimer timer(STAGE_DICTIONARY_QUERY);
+    for (char c : word) {
+        if (!isalpha(c)) {
+            return false;
         }
+    }
+
+    if (find_known_variants(word, ret)) {
+        return !ret.empty();
+    }
+    std::vector<WordVariant> new_variants;
+    return look_up_variants(word, new_variants) && cache_variants(word, new_variants, ret);
+}
+
+void query_dictionary(const std::vector<std::string>& words, std::vector<VariantsView>& ret) {
+    StageTimer timer(STAGE_DICTIONARY_QUERY);
+    ret.clear();
+    ret.resize(words.size());
+
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (std::all_of(words[i].begin(), words[i].end(), isalpha) && !find_known_variants(words[i], ret[i])) {
+            misses.push_back(i);
         }
     }
+    if (misses.empty()) {
+        return;
+    }
 
-    return ret.size();
+    // Misses the in-process backends can answer are answered inline, and the rest are sent to the subprocesses
+    std::vector<size_t> subprocess_misses;
+    for (size_t i : misses) {
+        std::vector<WordVariant> new_variants;
+        if (look_up_variants_in_process(words[i], new_variants) || !get_whitakers_words()) {
+            cache_variants(words[i], new_variants, ret[i]);
+        } else {
+            subprocess_misses.push_back(i);
+        }
+    }
+
+    if (!subprocess_misses.empty()) {
+        // Every miss is written to the subprocesses up front, so their round trips overlap instead of adding up
+        std::vector<std::string> miss_words;
+        miss_words.reserve(subprocess_misses.size());
+        for (size_t i : subprocess_misses) {
+            miss_words.push_back(words[i]);
+        }
+
+        std::vector<std::string> outputs;
+        {
+            StageTimer subprocess_timer(STAGE_SUBPROCESS_WAIT);
+            get_whitakers_words()->query(miss_words, outputs);
+        }
+        for (size_t i = 0; i < subprocess_misses.size(); ++i) {
+            if (outputs[i].empty()) {
+                continue; // The word's process crashed
+            }
+            std::vector<WordVariant> new_variants;
+            parse_whitakers_words(miss_words[i], outputs[i], new_variants);
+            cache_variants(miss_words[i], new_variants, ret[subprocess_misses[i]]);
+        }
+    }
 }
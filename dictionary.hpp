@@ -1,12 +1,15 @@
 #pragma once
 
+#include "cache.hpp"
 #include "words.hpp"
 #include <iconv.h>
+#include <iterator>
 #include <locale.h>
 #include <memory>
 #include <stddef.h>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 constexpr size_t hash(std::string_view str, size_t i = 0) {
@@ -14,7 +17,7 @@ constexpr size_t hash(std::string_view str, size_t i = 0) {
 }
 
 struct WordVariant {
-    std::vector<std::shared_ptr<WordForm>> forms;
+    std::vector<WordForm> forms;
     std::string english_base;
     std::string definition;
     std::string breakdown;
@@ -22,13 +25,13 @@ struct WordVariant {
     static WordVariant make_proper_noun(const std::string& english_base) {
         return {
             .forms = {
-                std::make_shared<Noun>(0, CASUS_NOMINATIVE, false, GENDER_COMMON),
-                std::make_shared<Noun>(0, CASUS_GENITIVE, false, GENDER_COMMON),
-                std::make_shared<Noun>(0, CASUS_DATIVE, false, GENDER_COMMON),
-                std::make_shared<Noun>(0, CASUS_ACCUSATIVE, false, GENDER_COMMON),
-                std::make_shared<Noun>(0, CASUS_ABLATIVE, false, GENDER_COMMON),
-                std::make_shared<Noun>(0, CASUS_VOCATIVE, false, GENDER_COMMON),
-                std::make_shared<Noun>(0, CASUS_LOCATIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_NOMINATIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_GENITIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_DATIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_ACCUSATIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_ABLATIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_VOCATIVE, false, GENDER_COMMON),
+                WordForm::make_noun(0, CASUS_LOCATIVE, false, GENDER_COMMON),
             },
             .english_base = english_base,
         };
@@ -43,11 +46,127 @@ struct WordVariant {
     }
 };
 
+// Whether a form or variant is shown through a mask of parts of speech (one bit per PartOfSpeech)
+// A variant is shown if any of its forms is
+inline bool is_shown(const WordForm& form, unsigned parts_of_speech) {
+    return parts_of_speech >> form.part_of_speech & 1;
+}
+
+inline bool is_shown(const WordVariant& variant, unsigned parts_of_speech) {
+    for (const auto& form : variant.forms) {
+        if (is_shown(form, parts_of_speech)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A read-only range over the forms or variants shown through a mask of parts of speech, skipping the rest
+template <typename T>
+class MaskedRange {
+protected:
+    const T* first = nullptr;
+    const T* last = nullptr;
+    unsigned parts_of_speech = ~0u;
+
+public:
+    class iterator {
+    protected:
+        const T* it;
+        const T* last;
+        unsigned parts_of_speech;
+
+        void skip_hidden() {
+            while (it != last && !is_shown(*it, parts_of_speech)) {
+                ++it;
+            }
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        iterator(const T* it, const T* last, unsigned parts_of_speech):
+            it(it),
+            last(last),
+            parts_of_speech(parts_of_speech) {
+            skip_hidden();
+        }
+
+        reference operator*() const { return *it; }
+        pointer operator->() const { return it; }
+
+        iterator& operator++() {
+            ++it;
+            skip_hidden();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const iterator& other) const { return it == other.it; }
+        bool operator!=(const iterator& other) const { return it != other.it; }
+    };
+
+    MaskedRange() = default;
+    MaskedRange(const T* first, const T* last, unsigned parts_of_speech = ~0u):
+        first(first),
+        last(last),
+        parts_of_speech(parts_of_speech) {}
+
+    iterator begin() const { return iterator(first, last, parts_of_speech); }
+    iterator end() const { return iterator(last, last, parts_of_speech); }
+    size_t size() const { return std::distance(begin(), end()); }
+    bool empty() const { return begin() == end(); }
+    const T& front() const { return *begin(); }
+};
+
+// A read-only view of a word's variants, which are shared with the dictionary cache or statically allocated instead of copied
+// Holding onto a view keeps its variants alive
+// A view can be narrowed to some parts of speech without copying anything, in which case only the forms of those parts of speech, and the variants with any, are iterated over
+class VariantsView: public MaskedRange<WordVariant> {
+protected:
+    std::shared_ptr<const std::vector<WordVariant>> owner;
+
+public:
+    VariantsView() = default;
+    VariantsView(std::shared_ptr<const std::vector<WordVariant>> variants):
+        MaskedRange(variants->data(), variants->data() + variants->size()),
+        owner(std::move(variants)) {}
+    VariantsView(const WordVariant* first, const WordVariant* last):
+        MaskedRange(first, last) {}
+
+    // The forms of one of this view's variants that it shows
+    MaskedRange<WordForm> forms(const WordVariant& variant) const {
+        return MaskedRange<WordForm>(variant.forms.data(), variant.forms.data() + variant.forms.size(), parts_of_speech);
+    }
+
+    // Shows only the forms of one part of speech
+    // Returns false and leaves the view alone if it has none
+    bool narrow(PartOfSpeech part_of_speech) {
+        unsigned narrowed_parts_of_speech = parts_of_speech & 1u << part_of_speech;
+        if (MaskedRange(first, last, narrowed_parts_of_speech).empty()) {
+            return false;
+        }
+        parts_of_speech = narrowed_parts_of_speech;
+        return true;
+    }
+};
+
 class Transliterator {
 protected:
     locale_t us_locale;
     iconv_t cd;
 
+    void fold_with_iconv(std::string_view character, std::string& ret);
+
 public:
     Transliterator():
         us_locale(newlocale(LC_CTYPE_MASK, "en_US.utf8", nullptr)),
@@ -58,7 +177,59 @@ public:
         freelocale(us_locale);
     }
 
-    std::string operator()(std::string_view str);
+    // Folds text to plain ASCII, writing the result into ret
+    // Accented Latin letters and combining diacritics (macrons, breves, etc.) are folded from a table, and only other characters go through iconv
+    void operator()(std::string_view str, std::string& ret);
+
+    std::string operator()(std::string_view str) {
+        std::string ret;
+        (*this)(str, ret);
+        return ret;
+    }
+};
+
+// Parsers for the codes used in Whitaker's data files and output
+PartOfSpeech parse_part_of_speech(std::string_view str);
+Casus parse_casus(std::string_view str);
+Gender parse_gender(char c);
+Tense parse_tense(std::string_view str);
+Voice parse_voice(std::string_view str);
+Mood parse_mood(std::string_view str);
+Degree parse_degree(std::string_view str);
+NumeralType parse_numeral_type(std::string_view str);
+
+// Removes parenthesized and bracketed comments from a line of Whitaker's output
+void strip_comments(std::string_view line, std::string& ret);
+
+inline std::string strip_comments(std::string_view line) {
+    std::string ret;
+    strip_comments(line, ret);
+    return ret;
+}
+
+// Picks the first single-word gloss out of a definition, falling back to the first gloss
+std::string find_english_base(std::string_view definition);
+
+enum DictionaryBackend {
+    DICTIONARY_BACKEND_LEXICON,
+    DICTIONARY_BACKEND_ANALYZER,
+    DICTIONARY_BACKEND_WHITAKERS_WORDS,
 };
 
-size_t query_dictionary(const std::string& word, std::vector<WordVariant>& ret);
+// Maps the precompiled lexicon, falling back to the native analyzer, and then to Whitaker's Words subprocesses if its data files are missing
+// The subprocesses are also started as a fallback for words the lexicon or analyzer can't find, when bin/words exists
+DictionaryBackend init_dictionary(const std::string& whitakers_words_directory = "whitakers-words", const std::string& lexicon_path = "lexicon.bin");
+
+// Shared by all threads, and keyed on the word as it was passed to query_dictionary
+// Words that can't be found are cached as empty lists
+extern LRUCache<std::string, std::shared_ptr<const std::vector<WordVariant>>> dictionary_cache;
+
+// Finds the built-in entries for a word of ASCII letters, which take precedence over every backend's
+// They're statically allocated and never change, so the range can be held onto for the lifetime of the program
+std::pair<const WordVariant*, const WordVariant*> find_internal_variants(std::string_view word);
+
+// Variants are sorted with plain words before proper nouns, and shorter English bases first
+bool query_dictionary(const std::string& word, VariantsView& ret);
+// Looks up many words at once, leaving the views of words that can't be found empty
+// Words that aren't cached are sent to Whitaker's Words as a single batch, rather than one round trip at a time
+void query_dictionary(const std::vector<std::string>& words, std::vector<VariantsView>& ret);
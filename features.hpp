@@ -0,0 +1,100 @@
+#pragma once
+
+#include "dictionary.hpp"
+#include "words.hpp"
+#include <stdint.h>
+#include <vector>
+
+// Every feature that any of a word's candidate forms can take on, packed into bitsets
+// Checking whether some form of a word agrees with another form is then a few ANDs instead of a scan over every variant
+class FeatureSet {
+protected:
+    uint16_t parts_of_speech = 0;
+    uint64_t noun_like = 0; // Indexed by (case * 2 + plural) * 4 + gender
+    uint64_t adjectives = 0;
+    uint8_t verbs = 0;        // Bit 0 for singular, bit 1 for plural
+    uint8_t prepositions = 0; // Indexed by case
+
+    // Masks only ever err on the side of a match: forms outside the cases and genders that fit set every bit,
+    // and queries for them check every bit
+    static uint64_t agreement_bits(const WordForm& form) {
+        if (form.casus >= CASUS_NONE || (int) form.gender >= GENDER_NONE) {
+            return UINT64_MAX;
+        }
+        return (uint64_t) 1 << ((form.casus * 2 + form.plural) * 4 + form.gender);
+    }
+
+    // The bits of the forms that compare equal to the given case, number, and gender, with common gender matching any other
+    static uint64_t agreement_mask(Casus casus, bool plural, Gender gender) {
+        if (casus >= CASUS_NONE) {
+            return UINT64_MAX;
+        }
+
+        uint64_t genders;
+        switch (gender) {
+        case GENDER_COMMON: genders = 0b1111; break;
+        case GENDER_NONE: genders = 1 << GENDER_COMMON; break;
+        default: genders = (1 << gender) | (1 << GENDER_COMMON); break;
+        }
+        return genders << ((casus * 2 + plural) * 4);
+    }
+
+    static uint64_t agreement_mask(Casus casus, bool plural) {
+        return casus >= CASUS_NONE ? UINT64_MAX : (uint64_t) 0b1111 << ((casus * 2 + plural) * 4);
+    }
+
+    static uint64_t agreement_mask(Casus casus) {
+        return casus >= CASUS_NONE ? UINT64_MAX : (uint64_t) 0xFF << (casus * 8);
+    }
+
+public:
+    FeatureSet() = default;
+    FeatureSet(const VariantsView& word) {
+        for (const auto& variant : word) {
+            for (const auto& form : word.forms(variant)) {
+                add(form);
+            }
+        }
+    }
+
+    void add(const WordForm& form) {
+        parts_of_speech |= 1 << form.part_of_speech;
+        if (form.is_noun_like()) {
+            noun_like |= agreement_bits(form);
+        }
+        switch (form.part_of_speech) {
+        case PART_OF_SPEECH_ADJECTIVE: adjectives |= agreement_bits(form); break;
+        case PART_OF_SPEECH_VERB: verbs |= 1 << form.plural; break;
+        case PART_OF_SPEECH_PREPOSITION: prepositions |= 1 << form.casus; break;
+        default: break;
+        }
+    }
+
+    bool can_be(PartOfSpeech part_of_speech) const {
+        return parts_of_speech & (1 << part_of_speech);
+    }
+
+    bool can_be_noun_like(Casus casus) const {
+        return noun_like & agreement_mask(casus);
+    }
+
+    bool can_be_noun_like(Casus casus, bool plural) const {
+        return noun_like & agreement_mask(casus, plural);
+    }
+
+    bool can_be_noun_like(Casus casus, bool plural, Gender gender) const {
+        return noun_like & agreement_mask(casus, plural, gender);
+    }
+
+    bool can_be_adjective(Casus casus, bool plural, Gender gender) const {
+        return adjectives & agreement_mask(casus, plural, gender);
+    }
+
+    bool can_be_verb(bool plural) const {
+        return verbs & (1 << plural);
+    }
+
+    bool can_be_preposition(Casus casus) const {
+        return prepositions & (1 << casus);
+    }
+};
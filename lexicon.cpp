@@ -0,0 +1,339 @@
+#include "lexicon.hpp"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+static_assert(sizeof(LexiconHeader) == 88, "LexiconHeader must not contain padding");
+static_assert(sizeof(LexiconForm) == 12, "LexiconForm must not contain padding");
+static_assert(sizeof(LexiconAnalysis) == 12, "LexiconAnalysis must not contain padding");
+static_assert(sizeof(LexiconEntry) == 16, "LexiconEntry must not contain padding");
+static_assert(sizeof(LexiconPrefix) == 8, "LexiconPrefix must not contain padding");
+
+// The filter is split into blocks of 8 32-bit lanes, and each form sets one bit in every lane of a single block
+// That way, a query only ever touches one 32-byte block
+constexpr size_t filter_lane_count = 8;
+constexpr size_t filter_bits_per_form = 16;
+
+uint64_t hash_form(std::string_view form) {
+    uint64_t ret = 0xcbf29ce484222325;
+    for (char c : form) {
+        ret = (ret ^ (uint8_t) c) * 0x100000001b3;
+    }
+
+    // FNV-1a alone leaves the high bits, which pick the block, poorly mixed
+    ret = (ret ^ (ret >> 33)) * 0xff51afd7ed558ccd;
+    ret = (ret ^ (ret >> 33)) * 0xc4ceb9fe1a85ec53;
+    return ret ^ (ret >> 33);
+}
+
+size_t get_filter_block(uint64_t hash, uint32_t block_count) {
+    return ((hash >> 32) * block_count) >> 32;
+}
+
+uint32_t get_filter_mask(uint64_t hash, size_t lane) {
+    static constexpr uint32_t salts[filter_lane_count] = {0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31};
+    return 1u << (((uint32_t) hash * salts[lane]) >> 27);
+}
+
+Lexicon::Lexicon(const std::string& path) {
+    int fd;
+    if ((fd = open(path.c_str(), O_RDONLY)) == -1) {
+        throw std::runtime_error("Failed to open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("Failed to stat " + path + ": " + strerror(errno));
+    }
+    size = st.st_size;
+    if (size < sizeof(LexiconHeader)) {
+        close(fd);
+        throw std::runtime_error(path + " is too small to be a lexicon");
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + path + ": " + strerror(errno));
+    }
+    data = (const char*) mapping;
+    header = (const LexiconHeader*) data;
+
+    auto section_fits = [this](uint64_t offset, uint64_t count, size_t element_size) {
+        return offset <= size && count <= (size - offset) / element_size;
+    };
+    if (memcmp(header->magic, LEXICON_MAGIC, sizeof header->magic) || header->version != LEXICON_VERSION) {
+        munmap(mapping, size);
+        throw std::runtime_error(path + " is not a version " + std::to_string(LEXICON_VERSION) + " lexicon");
+    } else if (!section_fits(header->forms_offset, header->form_count, sizeof(LexiconForm)) ||
+               !section_fits(header->analyses_offset, header->analysis_count, sizeof(LexiconAnalysis)) ||
+               !section_fits(header->entries_offset, header->entry_count, sizeof(LexiconEntry)) ||
+               !section_fits(header->prefixes_offset, header->prefix_count, sizeof(LexiconPrefix)) ||
+               !section_fits(header->strings_offset, header->strings_size, 1) ||
+               !header->filter_block_count ||
+               !section_fits(header->filter_offset, (uint64_t) header->filter_block_count * filter_lane_count, sizeof(uint32_t))) {
+        munmap(mapping, size);
+        throw std::runtime_error(path + " is truncated");
+    }
+
+    forms = (const LexiconForm*) (data + header->forms_offset);
+    analyses = (const LexiconAnalysis*) (data + header->analyses_offset);
+    entries = (const LexiconEntry*) (data + header->entries_offset);
+    strings = data + header->strings_offset;
+    filter = (const uint32_t*) (data + header->filter_offset);
+
+    const LexiconPrefix* prefix_records = (const LexiconPrefix*) (data + header->prefixes_offset);
+    prefixes.reserve(header->prefix_count);
+    for (uint32_t i = 0; i < header->prefix_count; ++i) {
+        prefixes.push_back({
+            .fix = std::string(get_string(prefix_records[i].fix_offset, prefix_records[i].fix_size)),
+            .root = (PartOfSpeech) prefix_records[i].root,
+            .any_root = (bool) prefix_records[i].any_root,
+        });
+    }
+}
+
+Lexicon::~Lexicon() {
+    munmap((void*) data, size);
+}
+
+bool Lexicon::might_contain(std::string_view canonical_word) const {
+    uint64_t hash = hash_form(canonical_word);
+    const uint32_t* block = filter + get_filter_block(hash, header->filter_block_count) * filter_lane_count;
+    for (size_t i = 0; i < filter_lane_count; ++i) {
+        if (!(block[i] & get_filter_mask(hash, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Lexicon::lookup_forms(std::string_view word, std::vector<WordVariant>& ret, bool with_uniques) const {
+    std::string canonical_word = Analyzer::canonicalize(word);
+    if (!might_contain(canonical_word)) {
+        return ret.size();
+    }
+
+    const LexiconForm* forms_end = forms + header->form_count;
+    const LexiconForm* form = std::lower_bound(forms, forms_end, canonical_word, [this](const LexiconForm& form, const std::string& word) {
+        return get_string(form.string_offset, form.string_size) < word;
+    });
+    if (form == forms_end || get_string(form->string_offset, form->string_size) != canonical_word) {
+        return ret.size();
+    }
+
+    // Uncommon and archaic entries are only used if no other stem + ending pair matches
+    const LexiconAnalysis* first_analysis = analyses + form->first_analysis;
+    const LexiconAnalysis* last_analysis = first_analysis + form->analysis_count;
+    bool has_common = std::find_if(first_analysis, last_analysis, [this](const LexiconAnalysis& analysis) {
+        return !analysis.unique && entries[analysis.entry].common;
+    }) != last_analysis;
+
+    // Analyses of the same entry are adjacent, and are grouped into one variant
+    uint32_t last_entry = UINT32_MAX;
+    for (const LexiconAnalysis* analysis = first_analysis; analysis != last_analysis; ++analysis) {
+        const LexiconEntry& entry = entries[analysis->entry];
+        if (analysis->unique ? !with_uniques : has_common && !entry.common) {
+            continue;
+        }
+
+        if (analysis->unique || analysis->entry != last_entry) {
+            last_entry = analysis->unique ? UINT32_MAX : analysis->entry;
+            ret.push_back({
+                .english_base = std::string(get_string(entry.english_base_offset, entry.english_base_size)),
+                .definition = std::string(get_string(entry.definition_offset, entry.definition_size)),
+                .breakdown = analysis->stem_size < word.size() ? std::string(word.substr(0, analysis->stem_size)) + '.' + std::string(word.substr(analysis->stem_size)) : std::string(word),
+            });
+        }
+        ret.back().forms.push_back(analysis->form);
+    }
+
+    return ret.size();
+}
+
+size_t Lexicon::lookup(std::string_view word, std::vector<WordVariant>& ret) const {
+    size_t original_size = ret.size();
+    lookup_forms(word, ret, true);
+
+    // Fall back to removing prefixes
+    if (ret.size() == original_size) {
+        analyze_prefixes(word, prefixes, [this](std::string_view word, std::vector<WordVariant>& ret) {
+            return lookup_forms(word, ret, false);
+        },
+            ret);
+    }
+
+    return ret.size();
+}
+
+bool same_variants(const std::vector<WordVariant>& a, const std::vector<WordVariant>& b) {
+    // Genders are compared as numbers, since GENDER_COMMON equals every gender
+    auto same_forms = [](const WordForm& a, const WordForm& b) {
+        return a.part_of_speech == b.part_of_speech && a.casus == b.casus && (int) a.gender == (int) b.gender && a.degree == b.degree &&
+               a.tense == b.tense && a.voice == b.voice && a.mood == b.mood && a.numeral_type == b.numeral_type &&
+               a.person == b.person && a.plural == b.plural && a.declension == b.declension;
+    };
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [&same_forms](const WordVariant& a, const WordVariant& b) {
+        return a.english_base == b.english_base && a.definition == b.definition && a.breakdown == b.breakdown &&
+               std::equal(a.forms.begin(), a.forms.end(), b.forms.begin(), b.forms.end(), same_forms);
+    });
+}
+
+void Lexicon::compile(const Analyzer& analyzer, const std::string& path) {
+    std::vector<std::string> words;
+    analyzer.for_each_form([&words](const std::string& word) {
+        if (word.size() <= UINT8_MAX) {
+            words.push_back(word);
+        }
+    });
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    std::string strings;
+    auto add_string = [&strings](std::string_view str) {
+        uint32_t ret = strings.size();
+        strings += str;
+        return ret;
+    };
+
+    std::vector<LexiconForm> forms;
+    std::vector<LexiconAnalysis> analyses;
+    std::vector<LexiconAnalysis> word_analyses;
+    std::vector<const Analyzer::Entry*> entry_list;
+    std::unordered_map<const Analyzer::Entry*, uint32_t> entry_indices;
+    for (const auto& word : words) {
+        word_analyses.clear();
+        analyzer.for_each_analysis(word, [&word_analyses, &entry_list, &entry_indices](const Analyzer::Entry& entry, const Analyzer::Inflection& inflection, size_t stem_size, bool unique) {
+            auto entry_it = entry_indices.find(&entry);
+            if (entry_it == entry_indices.end()) {
+                entry_it = entry_indices.insert({&entry, entry_list.size()}).first;
+                entry_list.push_back(&entry);
+            }
+            LexiconAnalysis analysis = {
+                .entry = entry_it->second,
+                .stem_size = (uint8_t) stem_size,
+                .unique = unique,
+                .reserved = {},
+                .form = Analyzer::make_form(inflection, entry),
+            };
+
+            // Later analyses of an entry join its first one, like the analyzer's variants do
+            auto group_it = unique ? word_analyses.rend() : std::find_if(word_analyses.rbegin(), word_analyses.rend(), [&analysis](const LexiconAnalysis& other) {
+                return !other.unique && other.entry == analysis.entry;
+            });
+            word_analyses.insert(group_it == word_analyses.rend() ? word_analyses.end() : group_it.base(), analysis);
+        });
+        if (word_analyses.empty()) {
+            continue;
+        } else if (word_analyses.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many analyses of " + word);
+        }
+
+        forms.push_back({
+            .string_offset = add_string(word),
+            .first_analysis = (uint32_t) analyses.size(),
+            .string_size = (uint16_t) word.size(),
+            .analysis_count = (uint16_t) word_analyses.size(),
+        });
+        analyses.insert(analyses.end(), word_analyses.begin(), word_analyses.end());
+    }
+
+    std::vector<LexiconEntry> entries;
+    entries.reserve(entry_list.size());
+    for (const auto entry : entry_list) {
+        entries.push_back({
+            .english_base_offset = add_string(entry->english_base),
+            .definition_offset = add_string(entry->definition),
+            .english_base_size = (uint16_t) std::min<size_t>(entry->english_base.size(), UINT16_MAX),
+            .definition_size = (uint16_t) std::min<size_t>(entry->definition.size(), UINT16_MAX),
+            .common = entry->is_common(),
+            .reserved = {},
+        });
+    }
+
+    std::vector<LexiconPrefix> prefixes;
+    for (const auto& prefix : analyzer.get_prefixes()) {
+        prefixes.push_back({
+            .fix_offset = add_string(prefix.fix),
+            .fix_size = (uint16_t) prefix.fix.size(),
+            .root = (uint8_t) prefix.root,
+            .any_root = prefix.any_root,
+        });
+    }
+
+    std::vector<uint32_t> filter(std::max<size_t>(forms.size() * filter_bits_per_form / (filter_lane_count * 32), 1) * filter_lane_count);
+    for (const auto& form : forms) {
+        uint64_t hash = hash_form(std::string_view(strings.data() + form.string_offset, form.string_size));
+        uint32_t* block = filter.data() + get_filter_block(hash, filter.size() / filter_lane_count) * filter_lane_count;
+        for (size_t i = 0; i < filter_lane_count; ++i) {
+            block[i] |= get_filter_mask(hash, i);
+        }
+    }
+
+    LexiconHeader header = {};
+    memcpy(header.magic, LEXICON_MAGIC, sizeof header.magic);
+    header.version = LEXICON_VERSION;
+    header.form_count = forms.size();
+    header.analysis_count = analyses.size();
+    header.entry_count = entries.size();
+    header.prefix_count = prefixes.size();
+    header.strings_size = strings.size();
+    header.filter_block_count = filter.size() / filter_lane_count;
+
+    // Every section is aligned to 8 bytes
+    uint64_t offset = sizeof header;
+    auto place_section = [&offset](size_t size) {
+        uint64_t ret = offset = (offset + 7) & ~7;
+        offset += size;
+        return ret;
+    };
+    header.forms_offset = place_section(forms.size() * sizeof(LexiconForm));
+    header.analyses_offset = place_section(analyses.size() * sizeof(LexiconAnalysis));
+    header.entries_offset = place_section(entries.size() * sizeof(LexiconEntry));
+    header.prefixes_offset = place_section(prefixes.size() * sizeof(LexiconPrefix));
+    header.strings_offset = place_section(strings.size());
+    header.filter_offset = place_section(filter.size() * sizeof(uint32_t));
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    auto write_section = [&file](uint64_t offset, const void* data, size_t size) {
+        static constexpr char padding[8] = {};
+        file.write(padding, offset - file.tellp());
+        file.write((const char*) data, size);
+    };
+    file.write((const char*) &header, sizeof header);
+    write_section(header.forms_offset, forms.data(), forms.size() * sizeof(LexiconForm));
+    write_section(header.analyses_offset, analyses.data(), analyses.size() * sizeof(LexiconAnalysis));
+    write_section(header.entries_offset, entries.data(), entries.size() * sizeof(LexiconEntry));
+    write_section(header.prefixes_offset, prefixes.data(), prefixes.size() * sizeof(LexiconPrefix));
+    write_section(header.strings_offset, strings.data(), strings.size());
+    write_section(header.filter_offset, filter.data(), filter.size() * sizeof(uint32_t));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+
+    // The lexicon stands in for the analyzer, so it must answer exactly as the analyzer does
+    Lexicon lexicon(path);
+    std::vector<WordVariant> expected;
+    std::vector<WordVariant> actual;
+    for (const auto& word : words) {
+        expected.clear();
+        actual.clear();
+        analyzer.analyze(word, expected);
+        lexicon.lookup(word, actual);
+        if (!same_variants(expected, actual)) {
+            throw std::runtime_error("The lexicon in " + path + " disagrees with the analyzer on " + word);
+        }
+    }
+}
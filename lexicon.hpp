@@ -0,0 +1,106 @@
+#pragma once
+
+#include "analyzer.hpp"
+#include "dictionary.hpp"
+#include "words.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define LEXICON_MAGIC   "DECLLEX"
+#define LEXICON_VERSION 4
+
+// A lexicon file is laid out as a header followed by these sections:
+// forms (sorted by their canonical spelling), analyses, entries, prefixes, a string pool, and a Bloom filter of the forms
+struct LexiconHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t form_count;
+    uint32_t analysis_count;
+    uint32_t entry_count;
+    uint32_t prefix_count;
+    uint32_t strings_size;
+    uint32_t filter_block_count;
+    uint32_t reserved;
+    uint64_t forms_offset;
+    uint64_t analyses_offset;
+    uint64_t entries_offset;
+    uint64_t prefixes_offset;
+    uint64_t strings_offset;
+    uint64_t filter_offset;
+};
+
+struct LexiconForm {
+    uint32_t string_offset;
+    uint32_t first_analysis;
+    uint16_t string_size;
+    uint16_t analysis_count;
+};
+
+// A form's analyses are in the order Analyzer::analyze reports them, with those of the same entry made adjacent
+struct LexiconAnalysis {
+    uint32_t entry;
+    uint8_t stem_size;
+    uint8_t unique; // From UNIQUES.LAT, so it's its own variant and isn't tried without a prefix
+    uint8_t reserved[2];
+    WordForm form;
+};
+
+struct LexiconEntry {
+    uint32_t english_base_offset;
+    uint32_t definition_offset;
+    uint16_t english_base_size;
+    uint16_t definition_size;
+    uint8_t common;
+    uint8_t reserved[3];
+};
+
+struct LexiconPrefix {
+    uint32_t fix_offset;
+    uint16_t fix_size;
+    uint8_t root;
+    uint8_t any_root;
+};
+
+// A read-only, memory-mapped snapshot of every form the analyzer can produce
+// Many processes can map the same file, sharing one copy in the page cache
+class Lexicon {
+protected:
+    const char* data;
+    size_t size;
+
+    const LexiconHeader* header;
+    const LexiconForm* forms;
+    const LexiconAnalysis* analyses;
+    const LexiconEntry* entries;
+    const char* strings;
+    const uint32_t* filter;
+    std::vector<Analyzer::Prefix> prefixes;
+
+    std::string_view get_string(uint32_t offset, size_t size) const {
+        return std::string_view(strings + offset, size);
+    }
+
+    // False positives are possible, but false negatives aren't
+    bool might_contain(std::string_view canonical_word) const;
+    size_t lookup_forms(std::string_view word, std::vector<WordVariant>& ret, bool with_uniques) const;
+
+public:
+    // Throws std::runtime_error if the file can't be mapped or isn't a lexicon of the current version
+    Lexicon(const std::string& path);
+    Lexicon(const Lexicon&) = delete;
+    Lexicon& operator=(const Lexicon&) = delete;
+    ~Lexicon();
+
+    size_t lookup(std::string_view word, std::vector<WordVariant>& ret) const;
+
+    uint32_t form_count() const {
+        return header->form_count;
+    }
+
+    // Writes every form the analyzer can produce to a new lexicon file
+    // Throws std::runtime_error if the written lexicon doesn't look up every form exactly as the analyzer analyzes it
+    static void compile(const Analyzer& analyzer, const std::string& path);
+};
@@ -1,16 +1,29 @@
 #include "Polyweb/polyweb.hpp"
+#include "analyzer.hpp"
+#include "convert.hpp"
 #include "dictionary.hpp"
 #include "json.hpp"
+#include "lexicon.hpp"
+#include "metrics.hpp"
+#include "response_cache.hpp"
+#include "sentence.hpp"
 #include "words.hpp"
-#include <algorithm>
+#include <charconv>
 #include <ctype.h>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <iterator>
+#include <memory>
+#include <optional>
 #include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
 using nlohmann::json;
 
@@ -22,8 +35,101 @@ auto cross_origin_middleware(std::function<pw::HTTPResponse(const pw::Connection
     };
 }
 
+// Parses a command line argument made up of nothing but decimal digits, returning false if it isn't one or doesn't fit
+bool parse_count(const char* str, size_t& ret) {
+    const char* end = str + strlen(str);
+    auto result = std::from_chars(str, end, ret);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Parses a cache budget given in MiB into bytes
+bool parse_budget(const char* str, size_t& ret) {
+    if (!parse_count(str, ret) || ret > SIZE_MAX / (1024 * 1024)) {
+        return false;
+    }
+    ret *= 1024 * 1024;
+    return true;
+}
+
+// Reads the optional engine query parameter, returning false if it names an unknown engine
+bool get_resolution_engine(const pw::HTTPRequest& req, ResolutionEngine& ret) {
+    ret = RESOLUTION_ENGINE_GREEDY;
+    pw::QueryParameters::map_type::const_iterator engine_it;
+    if ((engine_it = req.query_parameters->find("engine")) != req.query_parameters->end()) {
+        if (engine_it->second == "beam") {
+            ret = RESOLUTION_ENGINE_BEAM;
+        } else if (engine_it->second != "greedy") {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sends a cached response, or just its tag if the client already has an identical copy
+pw::HTTPResponse send_cached_response(const pw::HTTPRequest& req, const CachedResponse& resp) {
+    pw::HTTPHeaders::const_iterator if_none_match_it;
+    if ((if_none_match_it = req.headers.find("If-None-Match")) != req.headers.end() && etag_matches(if_none_match_it->second, resp.etag)) {
+        return pw::HTTPResponse(304, std::string(), {{"ETag", resp.etag}});
+    }
+    return pw::HTTPResponse(200, resp.body, {{"Content-Type", resp.content_type}, {"ETag", resp.etag}});
+}
+
 int main(int argc, char* argv[]) {
-    std::string port = argc >= 2 ? argv[1] : "8000";
+    if (argc >= 2 && !strcmp(argv[1], "compile-lexicon")) {
+        std::string path = argc >= 3 ? argv[2] : "lexicon.bin";
+        try {
+            Analyzer analyzer;
+            Lexicon::compile(analyzer, path);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Compiled lexicon to " << path << std::endl;
+        return 0;
+    }
+
+    bool convert_mode = argc >= 2 && !strcmp(argv[1], "convert");
+    std::string input_path;
+    std::string output_path;
+    std::string failed_path;
+    size_t thread_count = std::thread::hardware_concurrency();
+    std::string port = "8000";
+    if (convert_mode) {
+        for (int i = 2; i < argc; ++i) {
+            if (i + 1 < argc && !strcmp(argv[i], "--in")) {
+                input_path = argv[++i];
+            } else if (i + 1 < argc && !strcmp(argv[i], "--out")) {
+                output_path = argv[++i];
+            } else if (i + 1 < argc && !strcmp(argv[i], "--failed")) {
+                failed_path = argv[++i];
+            } else if (i + 1 < argc && !strcmp(argv[i], "--threads") && parse_count(argv[i + 1], thread_count)) {
+                ++i;
+            } else {
+                input_path.clear();
+                break;
+            }
+        }
+        if (input_path.empty() || output_path.empty()) {
+            std::cerr << "Usage: " << argv[0] << " convert --in <corpus> --out <output> [--threads <count>] [--failed <failed lines>]" << std::endl;
+            return 1;
+        }
+    } else {
+        if (argc >= 2) {
+            port = argv[1];
+        }
+        size_t dictionary_budget;
+        size_t response_budget;
+        if ((argc >= 3 && !parse_budget(argv[2], dictionary_budget)) || (argc >= 4 && !parse_budget(argv[3], response_budget))) {
+            std::cerr << "Usage: " << argv[0] << " [port] [dictionary cache MiB] [response cache MiB]" << std::endl;
+            return 1;
+        }
+        if (argc >= 3) {
+            dictionary_cache.set_budget(dictionary_budget);
+        }
+        if (argc >= 4) {
+            response_cache.set_budget(response_budget);
+        }
+    }
 
     std::ofstream settings("whitakers-words/WORD.MOD");
     settings << "TRIM_OUTPUT                       Y\n"
@@ -68,7 +174,7 @@ int main(int argc, char* argv[]) {
                 "OMIT_UNCOMMON                     Y\n"
                 "DO_I_FOR_J                        Y\n"
                 "DO_U_FOR_V                        N\n"
-                "PAUSE_IN_SCREEN_OUTPUT            Y\n"
+                "PAUSE_IN_SCREEN_OUTPUT            N\n"
                 "NO_SCREEN_ACTIVITY                N\n"
                 "UPDATE_LOCAL_DICTIONARY           N\n"
                 "UPDATE_MEANINGS                   N\n"
@@ -78,6 +184,25 @@ int main(int argc, char* argv[]) {
                 "CHANGE_DEVELOPER_MODES_CHARACTER '!'\n";
     settings.close();
 
+    switch (init_dictionary()) {
+    case DICTIONARY_BACKEND_LEXICON: std::cout << "Using precompiled lexicon" << std::endl; break;
+    case DICTIONARY_BACKEND_ANALYZER: std::cout << "Using native analyzer" << std::endl; break;
+    case DICTIONARY_BACKEND_WHITAKERS_WORDS: std::cout << "Using Whitaker's Words subprocesses" << std::endl; break;
+    }
+    if (!init_irregular_verbs()) {
+        std::cerr << "Warning: Failed to load irregular verbs from irregular_verbs.json" << std::endl;
+    }
+
+    if (convert_mode) {
+        try {
+            convert_corpus(input_path, output_path, failed_path, thread_count);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     pn::init();
     pn::UniqueSocket<pw::Server> server;
 
@@ -98,38 +223,46 @@ int main(int argc, char* argv[]) {
                     return pw::HTTPResponse::make_basic(400);
                 }
 
-                std::vector<WordVariant> word;
                 thread_local Transliterator transliterator;
-                if (query_dictionary(transliterator(word_it->second), word)) {
-                    std::sort(word.begin(), word.end(), [](const auto& a, const auto& b) {
-                        bool a_has_upper = std::find_if(a.english_base.begin(), a.english_base.end(), isupper) != a.english_base.end();
-                        bool b_has_upper = std::find_if(b.english_base.begin(), b.english_base.end(), isupper) != b.english_base.end();
-                        if (a_has_upper == b_has_upper) {
-                            return a.english_base.size() < b.english_base.size();
-                        } else {
-                            return b_has_upper;
-                        }
-                    });
+                thread_local std::string transliterated_word;
+                transliterator(word_it->second, transliterated_word);
 
-                    json resp;
-                    for (const auto& variant : word) {
-                        json json_variant = {
-                            {"forms", json::array()},
-                            {"english_base", variant.english_base},
-                            {"definition", variant.definition},
-                            {"breakdown", variant.breakdown},
-                        };
-
-                        std::transform(variant.forms.begin(), variant.forms.end(), std::back_inserter(json_variant["forms"]), [&variant](const auto& form) {
-                            json ret = form->to_json();
-                            ret["english_equivalent"] = form->english_equivalent(variant.english_base);
-                            return ret;
-                        });
+                std::string cache_key = "/word_info " + transliterated_word;
+                std::shared_ptr<const CachedResponse> cached_resp;
+                if (response_cache.get(cache_key, cached_resp)) {
+                    return send_cached_response(req, *cached_resp);
+                }
 
-                        resp.push_back(json_variant);
+                VariantsView word;
+                if (query_dictionary(transliterated_word, word)) {
+                    StageTimer timer(STAGE_RENDERING);
+                    // Streamed straight into the body, in the same format as json::dump()
+                    thread_local std::string resp;
+                    resp = '[';
+                    for (const auto& variant : word) {
+                        if (resp.size() > 1) {
+                            resp.push_back(',');
+                        }
+                        resp += "{\"breakdown\":";
+                        serialize_string(resp, variant.breakdown);
+                        resp += ",\"definition\":";
+                        serialize_string(resp, variant.definition);
+                        resp += ",\"english_base\":";
+                        serialize_string(resp, variant.english_base);
+                        resp += ",\"forms\":[";
+                        for (auto form_it = variant.forms.begin(); form_it != variant.forms.end(); ++form_it) {
+                            if (form_it != variant.forms.begin()) {
+                                resp.push_back(',');
+                            }
+                            serialize_form(resp, *form_it, english_equivalent(*form_it, variant.english_base));
+                        }
+                        resp += "]}";
                     }
+                    resp.push_back(']');
 
-                    return pw::HTTPResponse(200, resp.dump(), {{"Content-Type", "application/json"}});
+                    cached_resp = make_cached_response(resp, "application/json");
+                    response_cache.put(cache_key, cached_resp, estimate_size(cache_key, *cached_resp));
+                    return send_cached_response(req, *cached_resp);
                 } else {
                     return pw::HTTPResponse::make_basic(404);
                 }
@@ -144,587 +277,115 @@ int main(int argc, char* argv[]) {
                 }
 
                 pw::QueryParameters::map_type::const_iterator input_sentence_it;
-                if ((input_sentence_it = req.query_parameters->find("sentence")) == req.query_parameters->end()) {
+                ResolutionEngine engine;
+                if ((input_sentence_it = req.query_parameters->find("sentence")) == req.query_parameters->end() ||
+                    !get_resolution_engine(req, engine)) {
                     return pw::HTTPResponse::make_basic(400);
                 }
 
-                thread_local Transliterator transliterator;
-                std::vector<std::string> split_input_sentence = pw::string::split_and_trim(transliterator(input_sentence_it->second), ' ');
-                if (split_input_sentence.empty()) {
-                    return pw::HTTPResponse::make_basic(400);
-                }
+                thread_local SentenceAnalyzer analyzer;
+                thread_local SentenceAnalyzer::Result result;
+                analyzer.split(input_sentence_it->second, result);
 
-                std::vector<std::vector<WordVariant>> input_words;
-                for (auto string_word_it = split_input_sentence.begin(); string_word_it != split_input_sentence.end(); ++string_word_it) {
-                    std::string stripped_word = *string_word_it;
-                    stripped_word.erase(std::remove_if(stripped_word.begin(), stripped_word.end(), ispunct), stripped_word.end()); // Remove punctuation in the middle
-
-                    std::vector<WordVariant> word;
-                    if (!query_dictionary(stripped_word, word)) {
-                        if (pw::string::ends_with(stripped_word, "que")) {
-                            string_word_it = std::next(split_input_sentence.insert(string_word_it, "et"));
-                            input_words.push_back({
-                                {
-                                    .forms = {std::make_shared<Conjunction>()},
-                                    .english_base = "and",
-                                },
-                            });
-                            stripped_word.erase(stripped_word.size() - 3);
-                            if (!query_dictionary(stripped_word, word)) {
-                                if (isupper(stripped_word.front())) {
-                                    input_words.push_back({WordVariant::make_proper_noun(stripped_word)});
-                                    continue;
-                                } else {
-                                    return pw::HTTPResponse::make_basic(400);
-                                }
-                            }
-                        } else if (pw::string::ends_with(stripped_word, "cum")) {
-                            string_word_it = std::next(split_input_sentence.insert(string_word_it, "cum"));
-                            input_words.push_back({
-                                {
-                                    .forms = {std::make_shared<Preposition>(CASUS_ABLATIVE)},
-                                    .english_base = "with",
-                                },
-                            });
-                            stripped_word.erase(stripped_word.size() - 3);
-                            if (!query_dictionary(stripped_word, word)) {
-                                if (isupper(stripped_word.front())) {
-                                    input_words.push_back({WordVariant::make_proper_noun(stripped_word)});
-                                    continue;
-                                } else {
-                                    return pw::HTTPResponse::make_basic(400);
-                                }
-                            }
-                        } else if (pw::string::ends_with(stripped_word, "ne")) {
-                            stripped_word.erase(stripped_word.size() - 2);
-                            if (!query_dictionary(stripped_word, word)) {
-                                if (isupper(stripped_word.front())) {
-                                    input_words.push_back({WordVariant::make_proper_noun(stripped_word)});
-                                    continue;
-                                } else {
-                                    return pw::HTTPResponse::make_basic(400);
-                                }
-                            } else {
-                                for (auto variant_it = word.begin(); variant_it != word.end();) {
-                                    variant_it->forms.erase(std::remove_if(variant_it->forms.begin(), variant_it->forms.end(), [](const auto& form) {
-                                        return form->part_of_speech != PART_OF_SPEECH_VERB;
-                                    }),
-                                        variant_it->forms.end());
-                                    if (!variant_it->is_valid()) {
-                                        variant_it = word.erase(variant_it);
-                                    } else {
-                                        ++variant_it;
-                                    }
-                                }
-                                if (word.empty()) {
-                                    return pw::HTTPResponse::make_basic(400);
-                                }
-                            }
-                        } else if (isupper(stripped_word.front())) {
-                            input_words.push_back({WordVariant::make_proper_noun(stripped_word)});
-                            continue;
-                        } else {
-                            return pw::HTTPResponse::make_basic(400);
-                        }
+                std::string cache_key = "/sentence_info " + std::to_string(engine) + ' ' + result.text;
+                std::shared_ptr<const CachedResponse> cached_resp;
+                if (!response_cache.get(cache_key, cached_resp)) {
+                    if (!analyzer.lookup(result)) {
+                        return pw::HTTPResponse::make_basic(400);
                     }
+                    analyzer.resolve(result, engine);
+                    analyzer.render(result);
 
-                    std::sort(word.begin(), word.end(), [](const auto& a, const auto& b) {
-                        bool a_has_upper = std::find_if(a.english_base.begin(), a.english_base.end(), isupper) != a.english_base.end();
-                        bool b_has_upper = std::find_if(b.english_base.begin(), b.english_base.end(), isupper) != b.english_base.end();
-                        if (a_has_upper == b_has_upper) {
-                            return a.english_base.size() < b.english_base.size();
-                        } else {
-                            return b_has_upper;
-                        }
-                    });
-                    input_words.push_back(std::move(word));
+                    cached_resp = make_cached_response(result.ir, "text/plain");
+                    response_cache.put(cache_key, cached_resp, estimate_size(cache_key, *cached_resp));
                 }
+                return send_cached_response(req, *cached_resp);
+            }),
+        });
 
-                std::vector<std::pair<std::string, std::shared_ptr<WordForm>>> output_forms;
-                {
-                    // PHASE 1: RESOLVE GIVENS
-                    output_forms.reserve(input_words.size());
-                    for (const auto& word : input_words) {
-                        if (word.size() == 1 && word.front().forms.size() == 1) {
-                            output_forms.push_back({word.front().english_base, word.front().forms.front()});
-                        } else {
-                            output_forms.push_back({{}, nullptr});
-                        }
-                    }
-
-                    // PHASE 2: RESOLVE UNKNOWNS
-                    bool resolved;
-                    do {
-                        resolved = false;
-
-                        // PHASE 2.1: RESOLVE UNKNOWNS USING KNOWN SURROUNDINGS
-                        for (size_t i = 0; i < output_forms.size(); ++i) {
-                            auto& current_form = output_forms[i];
-
-                            if (!current_form.second) {
-                                const auto& current_word = input_words[i];
-
-                                if (i && output_forms[i - 1].second && !ispunct(split_input_sentence[i - 1].back())) {
-                                    const auto& prev_form = output_forms[i - 1];
-                                    switch (prev_form.second->part_of_speech) {
-                                    case PART_OF_SPEECH_CONJUNCTION:
-                                        if (i != 1 &&
-                                            output_forms[i - 2].second &&
-                                            !ispunct(split_input_sentence[i - 2].back()) &&
-                                            (prev_form.first == "and" || prev_form.first == "or")) {
-                                            const auto& prev_prev_form = output_forms[i - 2];
-                                            switch (prev_prev_form.second->part_of_speech) {
-                                            case PART_OF_SPEECH_NOUN:
-                                            case PART_OF_SPEECH_PRONOUN:
-                                            case PART_OF_SPEECH_PARTICIPLE:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->is_noun_like() &&
-                                                            form->get_casus() == prev_prev_form.second->get_casus() &&
-                                                            form->is_plural() == prev_prev_form.second->is_plural()) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_VERB:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->part_of_speech == PART_OF_SPEECH_VERB &&
-                                                            form->is_plural() == prev_prev_form.second->is_plural()) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_ADJECTIVE:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
-                                                            form->get_casus() == prev_prev_form.second->get_casus() &&
-                                                            form->is_plural() == prev_prev_form.second->is_plural() &&
-                                                            form->get_gender() == prev_prev_form.second->get_gender()) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_ADVERB:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->part_of_speech == PART_OF_SPEECH_ADVERB) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            default:
-                                                break;
-                                            }
-                                        }
-                                        break;
-
-                                    case PART_OF_SPEECH_PREPOSITION:
-                                        for (const auto& variant : current_word) {
-                                            for (const auto& form : variant.forms) {
-                                                if (form->is_noun_like() && form->get_casus() == prev_form.second->get_casus()) {
-                                                    current_form = {variant.english_base, form};
-                                                    goto next_form;
-                                                }
-                                            }
-                                        }
-                                        break;
-
-                                    case PART_OF_SPEECH_NOUN:
-                                    case PART_OF_SPEECH_PRONOUN:
-                                    case PART_OF_SPEECH_PARTICIPLE:
-                                        for (const auto& variant : current_word) {
-                                            for (const auto& form : variant.forms) {
-                                                if (form->part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
-                                                    form->get_casus() == prev_form.second->get_casus() &&
-                                                    form->is_plural() == prev_form.second->is_plural() &&
-                                                    form->get_gender() == prev_form.second->get_gender()) {
-                                                    current_form = {variant.english_base, form};
-                                                    goto next_form;
-                                                }
-                                            }
-                                        }
-                                        break;
-
-                                    case PART_OF_SPEECH_ADVERB:
-                                        for (const auto& variant : current_word) {
-                                            for (const auto& form : variant.forms) {
-                                                if (form->part_of_speech == PART_OF_SPEECH_VERB) {
-                                                    current_form = {variant.english_base, form};
-                                                    goto next_form;
-                                                }
-                                            }
-                                        }
-                                        break;
-
-                                    default:
-                                        break;
-                                    }
-                                }
-
-                                if (i != output_forms.size() - 1 &&
-                                    output_forms[i + 1].second &&
-                                    !ispunct(split_input_sentence[i].back()) &&
-                                    !ispunct(split_input_sentence[i + 1].back())) {
-                                    const auto& next_form = output_forms[i + 1];
-                                    switch (next_form.second->part_of_speech) {
-                                    case PART_OF_SPEECH_CONJUNCTION:
-                                        if ((next_form.first == "and" || next_form.first == "or") && i != output_forms.size() - 2 && output_forms[i + 2].second) {
-                                            const auto& next_next_form = output_forms[i + 2];
-                                            switch (next_next_form.second->part_of_speech) {
-                                            case PART_OF_SPEECH_NOUN:
-                                            case PART_OF_SPEECH_PRONOUN:
-                                            case PART_OF_SPEECH_PARTICIPLE:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->is_noun_like() &&
-                                                            form->get_casus() == next_next_form.second->get_casus() &&
-                                                            form->is_plural() == next_next_form.second->is_plural()) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_VERB:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->part_of_speech == PART_OF_SPEECH_VERB &&
-                                                            form->is_plural() == next_next_form.second->is_plural()) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_ADJECTIVE:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
-                                                            form->get_casus() == next_next_form.second->get_casus() &&
-                                                            form->is_plural() == next_next_form.second->is_plural() &&
-                                                            form->get_gender() == next_next_form.second->get_gender()) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_ADVERB:
-                                                for (const auto& variant : current_word) {
-                                                    for (const auto& form : variant.forms) {
-                                                        if (form->part_of_speech == PART_OF_SPEECH_ADVERB) {
-                                                            current_form = {variant.english_base, form};
-                                                            goto next_form;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            default:
-                                                break;
-                                            }
-                                        }
-                                        break;
-
-                                    case PART_OF_SPEECH_NOUN:
-                                    case PART_OF_SPEECH_PRONOUN:
-                                    case PART_OF_SPEECH_PARTICIPLE:
-                                        for (const auto& variant : current_word) {
-                                            for (const auto& form : variant.forms) {
-                                                if (form->part_of_speech == PART_OF_SPEECH_PREPOSITION &&
-                                                    form->get_casus() == next_form.second->get_casus()) {
-                                                    current_form = {variant.english_base, form};
-                                                    goto next_form;
-                                                }
-                                            }
-                                        }
-                                        break;
-
-                                    case PART_OF_SPEECH_ADJECTIVE:
-                                        for (const auto& variant : current_word) {
-                                            for (const auto& form : variant.forms) {
-                                                if (form->is_noun_like() &&
-                                                    form->get_casus() == next_form.second->get_casus() &&
-                                                    form->is_plural() == next_form.second->is_plural() &&
-                                                    form->get_gender() == next_form.second->get_gender()) {
-                                                    current_form = {variant.english_base, form};
-                                                    goto next_form;
-                                                }
-                                            }
-                                        }
-                                        break;
-
-                                    case PART_OF_SPEECH_VERB:
-                                        for (const auto& variant : current_word) {
-                                            for (const auto& form : variant.forms) {
-                                                if (form->part_of_speech == PART_OF_SPEECH_ADVERB) {
-                                                    current_form = {variant.english_base, form};
-                                                    goto next_form;
-                                                }
-                                            }
-                                        }
-                                        break;
-
-                                    default:
-                                        break;
-                                    }
-                                }
-                            }
-
-                            continue;
-
-                        next_form:
-                            resolved = true;
-                        }
-                        if (resolved) {
-                            goto next_cycle;
-                        }
+    server->route("/sentence_info/batch",
+        pw::HTTPRoute {
+            cross_origin_middleware([](const pw::Connection&, const pw::HTTPRequest& req, void*) {
+                // Batches share one worker pool and are answered in one response, so they're kept small enough not to hog either
+                static constexpr size_t max_body_size = 1024 * 1024;
+                static constexpr size_t max_sentence_count = 1000;
+
+                if (req.method != "POST") {
+                    return pw::HTTPResponse::make_basic(405, {{"Allow", "POST"}});
+                } else if (req.body.size() > max_body_size) {
+                    return pw::HTTPResponse::make_basic(413);
+                }
 
-                        // PHASE 2.2: RESOLVE SETS OF UNKNOWNS USING COMMONALITIES
-                        for (size_t i = 0; i < output_forms.size() - 1; ++i) {
-                            auto& current_form = output_forms[i];
-                            auto& next_form = output_forms[i + 1];
-                            if (current_form.second) {
-                                if (i &&
-                                    current_form.second->part_of_speech == PART_OF_SPEECH_CONJUNCTION &&
-                                    (current_form.first == "and" || current_form.first == "or") &&
-                                    !output_forms[i - 1].second &&
-                                    !next_form.second &&
-                                    !ispunct(split_input_sentence[i - 1].back()) &&
-                                    !ispunct(split_input_sentence[i].back())) {
-                                    auto& prev_form = output_forms[i - 1];
-                                    const auto& prev_word = input_words[i - 1];
-                                    for (const auto& variant_a : prev_word) {
-                                        for (const auto& form_a : variant_a.forms) {
-                                            const auto& next_word = input_words[i + 1];
-                                            switch (form_a->part_of_speech) {
-                                            case PART_OF_SPEECH_NOUN:
-                                            case PART_OF_SPEECH_PRONOUN:
-                                            case PART_OF_SPEECH_PARTICIPLE:
-                                                for (const auto& variant_b : next_word) {
-                                                    for (const auto& form_b : variant_b.forms) {
-                                                        if (form_b->is_noun_like() &&
-                                                            form_a->get_casus() == form_b->get_casus() &&
-                                                            form_a->is_plural() == form_b->is_plural()) {
-                                                            prev_form = {variant_a.english_base, form_a};
-                                                            next_form = {variant_b.english_base, form_b};
-                                                            goto next_cycle;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_VERB:
-                                                for (const auto& variant_b : next_word) {
-                                                    for (const auto& form_b : variant_b.forms) {
-                                                        if (form_b->part_of_speech == PART_OF_SPEECH_VERB &&
-                                                            form_a->is_plural() == form_b->is_plural()) {
-                                                            prev_form = {variant_a.english_base, form_a};
-                                                            next_form = {variant_b.english_base, form_b};
-                                                            goto next_cycle;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_ADJECTIVE:
-                                                for (const auto& variant_b : next_word) {
-                                                    for (const auto& form_b : variant_b.forms) {
-                                                        if (form_b->part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
-                                                            form_a->get_casus() == form_b->get_casus() &&
-                                                            form_a->is_plural() == form_b->is_plural() &&
-                                                            form_a->get_gender() == form_b->get_gender()) {
-                                                            prev_form = {variant_a.english_base, form_a};
-                                                            next_form = {variant_b.english_base, form_b};
-                                                            goto next_cycle;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            case PART_OF_SPEECH_ADVERB:
-                                                for (const auto& variant_b : next_word) {
-                                                    for (const auto& form_b : variant_b.forms) {
-                                                        if (form_b->part_of_speech == PART_OF_SPEECH_ADVERB) {
-                                                            prev_form = {variant_a.english_base, form_a};
-                                                            next_form = {variant_b.english_base, form_b};
-                                                            goto next_cycle;
-                                                        }
-                                                    }
-                                                }
-                                                break;
-
-                                            default:
-                                                break;
-                                            }
-                                        }
-                                    }
-                                }
-                            } else if (!next_form.second) {
-                                const auto& current_word = input_words[i];
-                                for (const auto& variant_a : current_word) {
-                                    for (const auto& form_a : variant_a.forms) {
-                                        if (form_a->part_of_speech == PART_OF_SPEECH_PREPOSITION) {
-                                            const auto& next_word = input_words[i + 1];
-                                            for (const auto& variant_b : next_word) {
-                                                for (const auto& form_b : variant_b.forms) {
-                                                    if (form_b->is_noun_like() && form_a->get_casus() == form_b->get_casus()) {
-                                                        current_form = {variant_a.english_base, form_a};
-                                                        next_form = {variant_b.english_base, form_b};
-                                                        goto next_cycle;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                bool tsv = false;
+                pw::QueryParameters::map_type::const_iterator format_it;
+                if ((format_it = req.query_parameters->find("format")) != req.query_parameters->end()) {
+                    if (format_it->second == "tsv") {
+                        tsv = true;
+                    } else if (format_it->second != "ndjson") {
+                        return pw::HTTPResponse::make_basic(400);
+                    }
+                }
 
-                        // PHASE 2.3: NAIVELY DISCOVER ADVERBS
-                        for (size_t i = 0; i < output_forms.size(); ++i) {
-                            auto& current_form = output_forms[i];
-                            if (!current_form.second) {
-                                const auto& current_word = input_words[i];
-                                for (const auto& variant : current_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->part_of_speech == PART_OF_SPEECH_ADVERB) {
-                                            current_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                ResolutionEngine engine;
+                if (!get_resolution_engine(req, engine)) {
+                    return pw::HTTPResponse::make_basic(400);
+                }
 
-                        // PHASE 2.4: NAIVELY DISCOVER GENITIVES, DATIVES, AND ABLATIVES AFTER OTHER NOUN-LIKES
-                        for (size_t i = 0; i < output_forms.size() - 1; ++i) {
-                            const auto& current_form = output_forms[i];
-                            auto& next_form = output_forms[i + 1];
-                            if (current_form.second && current_form.second->is_noun_like() && !next_form.second) {
-                                const auto& next_word = input_words[i + 1];
-
-                                // Check for genitives
-                                for (const auto& variant : next_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->is_noun_like() && form->get_casus() == CASUS_GENITIVE) {
-                                            next_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-
-                                // Check for datives
-                                for (const auto& variant : next_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->is_noun_like() && form->get_casus() == CASUS_DATIVE) {
-                                            next_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-
-                                // Check for ablatives
-                                for (const auto& variant : next_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->is_noun_like() && form->get_casus() == CASUS_ABLATIVE) {
-                                            next_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                // Every non-blank line of the body is a sentence
+                std::vector<std::string_view> sentences;
+                std::string_view body(req.body.data(), req.body.size());
+                for (size_t line_begin = 0, line_end; line_begin < body.size(); line_begin = line_end + 1) {
+                    if ((line_end = body.find('\n', line_begin)) == std::string_view::npos) {
+                        line_end = body.size();
+                    }
 
-                        // PHASE 2.5: NAIVELY DISCOVER SUBJECTS, OBJECTS, AND VERBS
-                        for (size_t i = 0; i < output_forms.size(); ++i) {
-                            auto& current_form = output_forms[i];
-                            if (!current_form.second) {
-                                const auto& current_word = input_words[i];
-
-                                // Check for subjects
-                                for (const auto& variant : current_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->is_noun_like() && form->get_casus() == CASUS_NOMINATIVE) {
-                                            current_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-
-                                // Check for objects
-                                for (const auto& variant : current_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->is_noun_like() && form->get_casus() == CASUS_ACCUSATIVE) {
-                                            current_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-
-                                // Check for verbs
-                                for (const auto& variant : current_word) {
-                                    for (const auto& form : variant.forms) {
-                                        if (form->part_of_speech == PART_OF_SPEECH_VERB) {
-                                            current_form = {variant.english_base, form};
-                                            goto next_cycle;
-                                        }
-                                    }
-                                }
-                            }
+                    std::string_view line = body.substr(line_begin, line_end - line_begin);
+                    if (!line.empty() && line.back() == '\r') {
+                        line.remove_suffix(1);
+                    }
+                    if (line.find_first_not_of(" \t") != std::string_view::npos) {
+                        if (sentences.size() == max_sentence_count) {
+                            return pw::HTTPResponse::make_basic(413);
                         }
+                        sentences.push_back(line);
+                    }
+                }
 
-                        // PHASE 2.6: PICK THE TOP FORM FOR REMAINING UNKNOWNS
-                        for (size_t i = 0; i < output_forms.size(); ++i) {
-                            auto& current_form = output_forms[i];
-                            if (!current_form.second) {
-                                current_form = {input_words[i].front().english_base, input_words[i].front().forms.front()};
-                                goto next_cycle;
-                            }
+                static WorkerPool pool;
+                std::vector<std::optional<std::string>> output_sentences;
+                analyze_sentences(pool, sentences, output_sentences, engine);
+
+                // Results are written in input order, with failed sentences left empty (TSV) or null (NDJSON)
+                std::string resp;
+                for (size_t i = 0; i < sentences.size(); ++i) {
+                    if (tsv) {
+                        std::string sentence(sentences[i]);
+                        std::replace(sentence.begin(), sentence.end(), '\t', ' ');
+                        resp += sentence + '\t';
+                        if (output_sentences[i]) {
+                            resp += *output_sentences[i];
                         }
-
-                        continue;
-
-                    next_cycle:
-                        resolved = true;
-                    } while (resolved);
+                    } else {
+                        json line = {
+                            {"sentence", std::string(sentences[i])},
+                            {"ir", output_sentences[i] ? json(*output_sentences[i]) : json(nullptr)},
+                        };
+                        resp += line.dump(-1, ' ', false, json::error_handler_t::replace); // Invalid UTF-8 in one line mustn't fail the whole batch
+                    }
+                    resp.push_back('\n');
                 }
 
-                std::string output_sentence;
-                for (size_t i = 0; i < output_forms.size(); ++i) {
-                    std::string beginning_punctuation;
-                    std::string ending_punctuation;
-                    for (size_t j = 0; j < split_input_sentence[i].size() && ispunct(split_input_sentence[i][j]); ++j) {
-                        beginning_punctuation.push_back(split_input_sentence[i][j]);
-                    }
-                    for (size_t j = split_input_sentence[i].size(); j-- > 0 && ispunct(split_input_sentence[i][j]);) {
-                        ending_punctuation.insert(ending_punctuation.begin(), split_input_sentence[i][j]);
-                    }
+                return pw::HTTPResponse(200, resp, {{"Content-Type", tsv ? "text/tab-separated-values" : "application/x-ndjson"}});
+            }),
+        });
 
-                    if (i) {
-                        output_sentence += "<S>";
-                    }
-                    output_sentence += beginning_punctuation + output_forms[i].second->tokenize() + output_forms[i].first + ending_punctuation;
+    server->route("/metrics",
+        pw::HTTPRoute {
+            cross_origin_middleware([](const pw::Connection&, const pw::HTTPRequest& req, void*) {
+                if (req.method != "GET") {
+                    return pw::HTTPResponse::make_basic(405, {{"Allow", "GET"}});
                 }
-
-                return pw::HTTPResponse(200, output_sentence, {{"Content-Type", "text/plain"}});
+                return pw::HTTPResponse(200, render_metrics(), {{"Content-Type", "text/plain; version=0.0.4"}});
             }),
         });
 
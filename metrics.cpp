@@ -0,0 +1,102 @@
+#include "metrics.hpp"
+#include "dictionary.hpp"
+#include "response_cache.hpp"
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+std::mutex registered_metrics_mutex;
+std::vector<std::shared_ptr<ThreadMetrics>> registered_metrics;
+
+ThreadMetrics& thread_metrics() {
+    thread_local std::shared_ptr<ThreadMetrics> metrics = []() {
+        auto ret = std::make_shared<ThreadMetrics>();
+        std::lock_guard<std::mutex> lock(registered_metrics_mutex);
+        registered_metrics.push_back(ret);
+        return ret;
+    }();
+    return *metrics;
+}
+
+std::string stage_to_string(Stage stage) {
+    switch (stage) {
+    case STAGE_TRANSLITERATION: return "transliteration";
+    case STAGE_DICTIONARY_QUERY: return "dictionary_query";
+    case STAGE_SUBPROCESS_WAIT: return "subprocess_wait";
+    case STAGE_RESOLUTION: return "resolution";
+    case STAGE_RENDERING: return "rendering";
+    default: throw std::logic_error("Invalid stage");
+    }
+}
+
+// Sums the histograms selected by get_histogram from every thread, and writes them out with cumulative buckets
+template <typename H, typename F>
+void render_histogram(std::ostream& ret, const std::string& name, const std::string& labels, double scale, F get_histogram) {
+    uint64_t buckets[H::bucket_count + 1] = {};
+    uint64_t sum = 0;
+    {
+        std::lock_guard<std::mutex> lock(registered_metrics_mutex);
+        for (const auto& metrics : registered_metrics) {
+            const H& histogram = get_histogram(*metrics);
+            for (size_t i = 0; i <= H::bucket_count; ++i) {
+                buckets[i] += histogram.get_bucket(i);
+            }
+            sum += histogram.get_sum();
+        }
+    }
+
+    std::string label_prefix = labels.empty() ? std::string() : labels + ',';
+    uint64_t count = 0;
+    for (size_t i = 0; i < H::bucket_count; ++i) {
+        count += buckets[i];
+        ret << name << "_bucket{" << label_prefix << "le=\"" << H::get_bound(i) * scale << "\"} " << count << '\n';
+    }
+    count += buckets[H::bucket_count];
+    ret << name << "_bucket{" << label_prefix << "le=\"+Inf\"} " << count << '\n';
+    ret << name << "_sum" << (labels.empty() ? std::string() : '{' + labels + '}') << ' ' << sum * scale << '\n';
+    ret << name << "_count" << (labels.empty() ? std::string() : '{' + labels + '}') << ' ' << count << '\n';
+}
+
+template <typename T>
+void render_metric(std::ostream& ret, const std::string& name, const std::string& type, const std::string& help, T value) {
+    ret << "# HELP " << name << ' ' << help << '\n';
+    ret << "# TYPE " << name << ' ' << type << '\n';
+    ret << name << ' ' << value << '\n';
+}
+
+void render_cache_metrics(std::ostream& ret, const std::string& cache, const std::string& description, const CacheStats& stats) {
+    render_metric(ret, "declengine_" + cache + "_cache_hits_total", "counter", description + " cache lookups that found an entry.", stats.hits);
+    render_metric(ret, "declengine_" + cache + "_cache_misses_total", "counter", description + " cache lookups that didn't find an entry.", stats.misses);
+    render_metric(ret, "declengine_" + cache + "_cache_hit_ratio", "gauge", "Fraction of " + cache + " cache lookups that found an entry.", stats.hits + stats.misses ? (double) stats.hits / (stats.hits + stats.misses) : 0.);
+    render_metric(ret, "declengine_" + cache + "_cache_evictions_total", "counter", description + " cache entries evicted to stay within budget.", stats.evictions);
+    render_metric(ret, "declengine_" + cache + "_cache_entries", "gauge", "Entries in the " + cache + " cache.", stats.entries);
+    render_metric(ret, "declengine_" + cache + "_cache_size_bytes", "gauge", "Estimated size of the " + cache + " cache.", stats.size);
+    render_metric(ret, "declengine_" + cache + "_cache_budget_bytes", "gauge", "Memory budget of the " + cache + " cache.", stats.budget);
+}
+
+std::string render_metrics() {
+    std::ostringstream ret;
+    ret.precision(12);
+
+    ret << "# HELP declengine_stage_duration_seconds Time spent in each stage of handling requests.\n"
+           "# TYPE declengine_stage_duration_seconds histogram\n";
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        render_histogram<DurationHistogram>(ret, "declengine_stage_duration_seconds", "stage=\"" + stage_to_string((Stage) stage) + '"', 1e-9, [stage](const ThreadMetrics& metrics) -> const DurationHistogram& {
+            return metrics.stage_durations[stage];
+        });
+    }
+
+    ret << "# HELP declengine_resolver_iterations Passes of the sentence resolver's main loop per sentence.\n"
+           "# TYPE declengine_resolver_iterations histogram\n";
+    render_histogram<CountHistogram>(ret, "declengine_resolver_iterations", {}, 1., [](const ThreadMetrics& metrics) -> const CountHistogram& {
+        return metrics.resolver_iterations;
+    });
+
+    render_cache_metrics(ret, "dictionary", "Dictionary", dictionary_cache.stats());
+    render_cache_metrics(ret, "response", "Response", response_cache.stats());
+
+    return ret.str();
+}
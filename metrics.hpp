@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+enum Stage {
+    STAGE_TRANSLITERATION,
+    STAGE_DICTIONARY_QUERY,
+    STAGE_SUBPROCESS_WAIT,
+    STAGE_RESOLUTION,
+    STAGE_RENDERING,
+    STAGE_COUNT,
+};
+
+// A histogram with buckets bounded by FirstBound * Factor^i, plus a final unbounded bucket
+// Each histogram is only ever written to by the thread that owns it, so observations are plain relaxed loads and stores instead of locked read-modify-writes
+// Other threads can read it at any time
+template <uint64_t FirstBound, uint64_t Factor>
+class Histogram {
+public:
+    static constexpr size_t bucket_count = 12;
+
+protected:
+    std::atomic<uint64_t> buckets[bucket_count + 1] {};
+    std::atomic<uint64_t> sum {0};
+
+public:
+    static constexpr uint64_t get_bound(size_t i) {
+        uint64_t ret = FirstBound;
+        while (i--) {
+            ret *= Factor;
+        }
+        return ret;
+    }
+
+    void observe(uint64_t value) {
+        size_t i = 0;
+        while (i < bucket_count && value > get_bound(i)) {
+            ++i;
+        }
+        buckets[i].store(buckets[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // Not cumulative, unlike Prometheus buckets
+    uint64_t get_bucket(size_t i) const {
+        return buckets[i].load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_sum() const {
+        return sum.load(std::memory_order_relaxed);
+    }
+};
+
+typedef Histogram<1000, 4> DurationHistogram; // In nanoseconds, from 1us to ~4s
+typedef Histogram<1, 2> CountHistogram;
+
+struct ThreadMetrics {
+    DurationHistogram stage_durations[STAGE_COUNT];
+    CountHistogram resolver_iterations; // Passes of the resolver's main loop per sentence
+};
+
+// The calling thread's metrics, which are registered on first use and kept around after the thread exits
+ThreadMetrics& thread_metrics();
+
+// Records the time between its construction and destruction as a run of the given stage
+class StageTimer {
+protected:
+    Stage stage;
+    std::chrono::steady_clock::time_point start_time;
+
+public:
+    StageTimer(Stage stage):
+        stage(stage),
+        start_time(std::chrono::steady_clock::now()) {}
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer() {
+        thread_metrics().stage_durations[stage].observe(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count());
+    }
+};
+
+// Sums every thread's metrics, and renders them along with the dictionary cache's stats in the Prometheus text format
+std::string render_metrics();
@@ -0,0 +1,49 @@
+#include "response_cache.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <utility>
+
+LRUCache<std::string, std::shared_ptr<const CachedResponse>> response_cache(16 * 1024 * 1024);
+
+std::shared_ptr<const CachedResponse> make_cached_response(std::string body, std::string content_type) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char c : body) {
+        hash = (hash ^ (uint8_t) c) * 0x100000001b3;
+    }
+
+    char etag[19];
+    snprintf(etag, sizeof etag, "\"%016llx\"", (unsigned long long) hash);
+    return std::make_shared<const CachedResponse>(CachedResponse {
+        .body = std::move(body),
+        .content_type = std::move(content_type),
+        .etag = etag,
+    });
+}
+
+size_t estimate_size(const std::string& key, const CachedResponse& response) {
+    return sizeof(std::string) + key.capacity() + sizeof(CachedResponse) + response.body.capacity() + response.content_type.capacity() + response.etag.capacity();
+}
+
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    for (size_t tag_begin = 0, tag_end; tag_begin < if_none_match.size(); tag_begin = tag_end + 1) {
+        if ((tag_end = if_none_match.find(',', tag_begin)) == std::string_view::npos) {
+            tag_end = if_none_match.size();
+        }
+
+        std::string_view tag = if_none_match.substr(tag_begin, tag_end - tag_begin);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+            tag.remove_suffix(1);
+        }
+        if (tag.substr(0, 2) == "W/") {
+            tag.remove_prefix(2); // If-None-Match uses weak comparison
+        }
+
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "cache.hpp"
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+// A fully rendered response, which is cached whole so that repeated requests skip lookup, resolution, and rendering
+struct CachedResponse {
+    std::string body;
+    std::string content_type;
+    std::string etag; // Derived from the body alone, so identical responses get identical tags
+};
+
+std::shared_ptr<const CachedResponse> make_cached_response(std::string body, std::string content_type);
+
+// Estimates how much memory a cached response takes up, including its key
+size_t estimate_size(const std::string& key, const CachedResponse& response);
+
+// Whether an If-None-Match header lists the tag (weakly or not), or is *
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
+
+// Shared by all threads, and keyed on the endpoint, any options that change the response, and the transliterated input
+// Only successful responses are cached
+extern LRUCache<std::string, std::shared_ptr<const CachedResponse>> response_cache;
@@ -0,0 +1,1058 @@
+#include "sentence.hpp"
+#include "Polyweb/string.hpp"
+#include "dictionary.hpp"
+#include "features.hpp"
+#include "metrics.hpp"
+#include "words.hpp"
+#include <algorithm>
+#include <ctype.h>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// How likely a form is on its own, following the order in which phases 2.3 and 2.5 of the greedy engine pick forms
+int preference_score(const WordForm& form) {
+    if (form.part_of_speech == PART_OF_SPEECH_ADVERB) {
+        return 2;
+    } else if ((form.is_noun_like() && (form.get_casus() == CASUS_NOMINATIVE || form.get_casus() == CASUS_ACCUSATIVE)) ||
+               form.part_of_speech == PART_OF_SPEECH_VERB) {
+        return 1;
+    }
+    return 0;
+}
+
+// How well a form fits the one right before it, following phases 2.1, 2.2, and 2.4 of the greedy engine
+int adjacency_score(const WordForm& prev, const WordForm& form) {
+    switch (prev.part_of_speech) {
+    case PART_OF_SPEECH_PREPOSITION:
+        if (form.is_noun_like() && form.get_casus() == prev.get_casus()) {
+            return 4;
+        }
+        break;
+
+    case PART_OF_SPEECH_NOUN:
+    case PART_OF_SPEECH_PRONOUN:
+    case PART_OF_SPEECH_PARTICIPLE:
+        if (form.part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
+            form.get_casus() == prev.get_casus() &&
+            form.is_plural() == prev.is_plural() &&
+            form.get_gender() == prev.get_gender()) {
+            return 4;
+        } else if (form.is_noun_like() &&
+                   (form.get_casus() == CASUS_GENITIVE || form.get_casus() == CASUS_DATIVE || form.get_casus() == CASUS_ABLATIVE)) {
+            return 1; // Phase 2.4 is only a guess
+        }
+        break;
+
+    case PART_OF_SPEECH_ADJECTIVE:
+        if (form.is_noun_like() &&
+            form.get_casus() == prev.get_casus() &&
+            form.is_plural() == prev.is_plural() &&
+            form.get_gender() == prev.get_gender()) {
+            return 4;
+        }
+        break;
+
+    case PART_OF_SPEECH_ADVERB:
+        if (form.part_of_speech == PART_OF_SPEECH_VERB) {
+            return 4;
+        }
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+// How well two forms on either side of "and" or "or" fit together, following phases 2.1 and 2.2 of the greedy engine
+int coordination_score(const WordForm& a, const WordForm& b) {
+    switch (a.part_of_speech) {
+    case PART_OF_SPEECH_NOUN:
+    case PART_OF_SPEECH_PRONOUN:
+    case PART_OF_SPEECH_PARTICIPLE:
+        if (b.is_noun_like() && b.get_casus() == a.get_casus() && b.is_plural() == a.is_plural()) {
+            return 4;
+        }
+        break;
+
+    case PART_OF_SPEECH_VERB:
+        if (b.part_of_speech == PART_OF_SPEECH_VERB && b.is_plural() == a.is_plural()) {
+            return 4;
+        }
+        break;
+
+    case PART_OF_SPEECH_ADJECTIVE:
+        if (b.part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
+            b.get_casus() == a.get_casus() &&
+            b.is_plural() == a.is_plural() &&
+            b.get_gender() == a.get_gender()) {
+            return 4;
+        }
+        break;
+
+    case PART_OF_SPEECH_ADVERB:
+        if (b.part_of_speech == PART_OF_SPEECH_ADVERB) {
+            return 4;
+        }
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+// Trims whitespace off a word of a sentence, and finds its punctuation and clitic before adding it to tokens
+// Blank words are skipped
+void add_token(std::string_view text, std::vector<SentenceAnalyzer::Token>& tokens) {
+    while (!text.empty() && isspace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isspace(text.back())) {
+        text.remove_suffix(1);
+    }
+    if (text.empty()) {
+        return;
+    }
+
+    SentenceAnalyzer::Token token;
+    token.text = text;
+    while (token.leading_punctuation < text.size() && ispunct(text[token.leading_punctuation])) {
+        ++token.leading_punctuation;
+    }
+    while (token.trailing_punctuation < text.size() && ispunct(text[text.size() - token.trailing_punctuation - 1])) {
+        ++token.trailing_punctuation;
+    }
+
+    std::string_view word = token.word();
+    if (pw::string::ends_with(word, "que") || pw::string::ends_with(word, "cum")) {
+        token.clitic = 3;
+    } else if (pw::string::ends_with(word, "ne")) {
+        token.clitic = 2;
+    }
+    tokens.push_back(token);
+}
+
+SentenceAnalyzer::Result::Result(const Result& other):
+    text(other.text),
+    tokens(other.tokens),
+    words(other.words),
+    forms(other.forms),
+    ir(other.ir) {
+    rebase_tokens(other.text.data(), other.text.size());
+}
+
+SentenceAnalyzer::Result::Result(Result&& other) {
+    *this = std::move(other);
+}
+
+SentenceAnalyzer::Result& SentenceAnalyzer::Result::operator=(const Result& other) {
+    if (this != &other) {
+        text = other.text;
+        tokens = other.tokens;
+        words = other.words;
+        forms = other.forms;
+        ir = other.ir;
+        rebase_tokens(other.text.data(), other.text.size());
+    }
+    return *this;
+}
+
+SentenceAnalyzer::Result& SentenceAnalyzer::Result::operator=(Result&& other) {
+    if (this != &other) {
+        // Short strings are copied rather than moved, so the text may still end up somewhere else
+        const char* old_text = other.text.data();
+        size_t old_size = other.text.size();
+        text = std::move(other.text);
+        tokens = std::move(other.tokens);
+        words = std::move(other.words);
+        forms = std::move(other.forms);
+        ir = std::move(other.ir);
+        rebase_tokens(old_text, old_size);
+    }
+    return *this;
+}
+
+void SentenceAnalyzer::Result::rebase_tokens(const char* old_text, size_t old_size) {
+    if (old_text == text.data()) {
+        return;
+    }
+
+    std::less<const char*> less;
+    for (auto& token : tokens) {
+        if (!less(token.text.data(), old_text) && less(token.text.data(), old_text + old_size)) {
+            token.text = std::string_view(text.data() + (token.text.data() - old_text), token.text.size());
+        }
+    }
+}
+
+// The words that -que and -cum are split off into
+const WordVariant que_variants[] = {
+    {
+        .forms = {WordForm::make_conjunction()},
+        .english_base = "and",
+    },
+};
+const WordVariant cum_variants[] = {
+    {
+        .forms = {WordForm::make_preposition(CASUS_ABLATIVE)},
+        .english_base = "with",
+    },
+};
+
+// Proper nouns are made up on the spot, so they're the only variants that aren't shared
+VariantsView make_proper_noun(const std::string& word) {
+    return VariantsView(std::make_shared<const std::vector<WordVariant>>(1, WordVariant::make_proper_noun(word)));
+}
+
+bool SentenceAnalyzer::analyze(std::string_view sentence, Result& ret, ResolutionEngine engine) {
+    split(sentence, ret);
+    return analyze_tokens(ret, engine);
+}
+
+bool SentenceAnalyzer::analyze(const std::vector<std::string>& tokens, Result& ret, ResolutionEngine engine) {
+    std::vector<size_t> token_ends;
+    ret.text.clear();
+    for (const auto& token : tokens) {
+        ret.text += transliterator(token);
+        token_ends.push_back(ret.text.size());
+        ret.text.push_back(' ');
+    }
+
+    ret.tokens.clear();
+    for (size_t i = 0, token_begin = 0; i < tokens.size(); token_begin = token_ends[i++] + 1) {
+        add_token(std::string_view(ret.text).substr(token_begin, token_ends[i] - token_begin), ret.tokens);
+    }
+    return analyze_tokens(ret, engine);
+}
+
+bool SentenceAnalyzer::analyze_tokens(Result& ret, ResolutionEngine engine) {
+    if (!lookup(ret)) {
+        return false;
+    }
+    resolve(ret, engine);
+    render(ret);
+    return true;
+}
+
+void SentenceAnalyzer::split(std::string_view sentence, Result& ret) {
+    transliterator(sentence, ret.text);
+    ret.tokens.clear();
+
+    std::string_view text = ret.text;
+    for (size_t token_begin = 0, token_end; token_begin < text.size(); token_begin = token_end + 1) {
+        if ((token_end = text.find(' ', token_begin)) == std::string_view::npos) {
+            token_end = text.size();
+        }
+        add_token(text.substr(token_begin, token_end - token_begin), ret.tokens);
+    }
+}
+
+void strip_word(const SentenceAnalyzer::Token& token, std::string& ret) {
+    ret = token.word();
+    ret.erase(std::remove_if(ret.begin(), ret.end(), ispunct), ret.end()); // Remove punctuation in the middle
+}
+
+void SentenceAnalyzer::prefetch(const std::vector<Token>& tokens) {
+    // Every distinct word is looked up in one batch, and then the words left over once clitics are split off in another
+    lookup_words.clear();
+    for (const auto& token : tokens) {
+        strip_word(token, stripped_word);
+        if (std::find(lookup_words.begin(), lookup_words.end(), stripped_word) == lookup_words.end()) {
+            lookup_words.push_back(stripped_word);
+        }
+    }
+    query_dictionary(lookup_words, lookup_results);
+
+    clitic_lookup_words.clear();
+    for (const auto& token : tokens) {
+        if (!token.clitic) {
+            continue;
+        }
+        strip_word(token, stripped_word);
+
+        VariantsView word;
+        if (!find_prefetched(stripped_word, word)) {
+            stripped_word.erase(stripped_word.size() - std::min<size_t>(token.clitic, stripped_word.size()));
+            if (std::find(lookup_words.begin(), lookup_words.end(), stripped_word) == lookup_words.end() &&
+                std::find(clitic_lookup_words.begin(), clitic_lookup_words.end(), stripped_word) == clitic_lookup_words.end()) {
+                clitic_lookup_words.push_back(stripped_word);
+            }
+        }
+    }
+    if (!clitic_lookup_words.empty()) {
+        query_dictionary(clitic_lookup_words, clitic_lookup_results);
+        lookup_words.insert(lookup_words.end(), clitic_lookup_words.begin(), clitic_lookup_words.end());
+        lookup_results.insert(lookup_results.end(), clitic_lookup_results.begin(), clitic_lookup_results.end());
+    }
+}
+
+bool SentenceAnalyzer::find_prefetched(const std::string& word, VariantsView& ret) const {
+    auto word_it = std::find(lookup_words.begin(), lookup_words.end(), word);
+    if (word_it == lookup_words.end() || lookup_results[word_it - lookup_words.begin()].empty()) {
+        return false;
+    }
+    ret = lookup_results[word_it - lookup_words.begin()];
+    return true;
+}
+
+bool SentenceAnalyzer::lookup(Result& ret) {
+    auto& split_input_sentence = ret.tokens;
+    auto& input_words = ret.words;
+    input_words.clear();
+    if (split_input_sentence.empty()) {
+        return false;
+    }
+    prefetch(split_input_sentence);
+
+    for (auto string_word_it = split_input_sentence.begin(); string_word_it != split_input_sentence.end(); ++string_word_it) {
+        strip_word(*string_word_it, stripped_word);
+
+        VariantsView word;
+        if (!find_prefetched(stripped_word, word)) {
+            std::string_view word_text = string_word_it->word();
+            std::string_view clitic = word_text.substr(word_text.size() - string_word_it->clitic);
+            if (clitic == "que") {
+                string_word_it = std::next(split_input_sentence.insert(string_word_it, Token {"et"}));
+                input_words.push_back(VariantsView(std::begin(que_variants), std::end(que_variants)));
+                stripped_word.erase(stripped_word.size() - clitic.size());
+                if (!find_prefetched(stripped_word, word)) {
+                    if (isupper(stripped_word.front())) {
+                        input_words.push_back(make_proper_noun(stripped_word));
+                        continue;
+                    } else {
+                        return false;
+                    }
+                }
+            } else if (clitic == "cum") {
+                string_word_it = std::next(split_input_sentence.insert(string_word_it, Token {"cum"}));
+                input_words.push_back(VariantsView(std::begin(cum_variants), std::end(cum_variants)));
+                stripped_word.erase(stripped_word.size() - clitic.size());
+                if (!find_prefetched(stripped_word, word)) {
+                    if (isupper(stripped_word.front())) {
+                        input_words.push_back(make_proper_noun(stripped_word));
+                        continue;
+                    } else {
+                        return false;
+                    }
+                }
+            } else if (clitic == "ne") {
+                stripped_word.erase(stripped_word.size() - clitic.size());
+                if (!find_prefetched(stripped_word, word)) {
+                    if (isupper(stripped_word.front())) {
+                        input_words.push_back(make_proper_noun(stripped_word));
+                        continue;
+                    } else {
+                        return false;
+                    }
+                } else if (!word.narrow(PART_OF_SPEECH_VERB)) {
+                    return false;
+                }
+            } else if (isupper(stripped_word.front())) {
+                input_words.push_back(make_proper_noun(stripped_word));
+                continue;
+            } else {
+                return false;
+            }
+        }
+
+        input_words.push_back(std::move(word));
+    }
+
+    return true;
+}
+
+void SentenceAnalyzer::resolve(Result& ret, ResolutionEngine engine) {
+    StageTimer timer(STAGE_RESOLUTION);
+    switch (engine) {
+    case RESOLUTION_ENGINE_GREEDY: resolve_greedy(ret); break;
+    case RESOLUTION_ENGINE_BEAM: resolve_beam(ret); break;
+    default: throw std::logic_error("Invalid resolution engine");
+    }
+}
+
+void SentenceAnalyzer::resolve_greedy(Result& ret) {
+    const auto& split_input_sentence = ret.tokens;
+    const auto& input_words = ret.words;
+    auto& output_forms = ret.forms;
+    word_features.assign(input_words.begin(), input_words.end());
+
+    // PHASE 1: RESOLVE GIVENS
+    output_forms.clear();
+    output_forms.reserve(input_words.size());
+    for (const auto& word : input_words) {
+        if (word.size() == 1 && word.forms(word.front()).size() == 1) {
+            output_forms.push_back({word.front().english_base, word.forms(word.front()).front()});
+        } else {
+            output_forms.push_back({{}, std::nullopt});
+        }
+    }
+
+    // PHASE 2: RESOLVE UNKNOWNS
+    // Every phase only looks at a few words around the one it's examining, so each keeps the set of words it could still pick,
+    // and only gets words back once something near them has been resolved, instead of rescanning the whole sentence every cycle
+    // Phases 2.3, 2.5, and 2.6 only depend on the word itself being unknown, so once they pass over a word, it stays out of their sets
+    for (auto& candidates : phase_candidates) {
+        candidates.fill(output_forms.size());
+    }
+    auto& known_surroundings_candidates = phase_candidates[0];
+    auto& commonality_candidates = phase_candidates[1];
+    auto& adverb_candidates = phase_candidates[2];
+    auto& case_candidates = phase_candidates[3];
+    auto& subject_object_verb_candidates = phase_candidates[4];
+    auto& top_form_candidates = phase_candidates[5];
+    auto resolve_word = [&](size_t i, const WordVariant& variant, const WordForm& form) {
+        output_forms[i] = {variant.english_base, form};
+        known_surroundings_candidates.insert_around(i, 2, 2);
+        commonality_candidates.insert_around(i, 1, 1);
+        case_candidates.insert_around(i, 1, 0);
+    };
+
+    bool resolved;
+    size_t iterations = 0;
+    do {
+        resolved = false;
+        ++iterations;
+
+        // PHASE 2.1: RESOLVE UNKNOWNS USING KNOWN SURROUNDINGS
+        for (size_t i = known_surroundings_candidates.next(0); i < output_forms.size(); i = known_surroundings_candidates.next(i + 1)) {
+            known_surroundings_candidates.erase(i);
+            const auto& current_form = output_forms[i];
+
+            if (!current_form.second) {
+                const auto& current_word = input_words[i];
+
+                if (i && output_forms[i - 1].second && !split_input_sentence[i - 1].trailing_punctuation) {
+                    const auto& prev_form = output_forms[i - 1];
+                    switch (prev_form.second->part_of_speech) {
+                    case PART_OF_SPEECH_CONJUNCTION:
+                        if (i != 1 &&
+                            output_forms[i - 2].second &&
+                            !split_input_sentence[i - 2].trailing_punctuation &&
+                            (prev_form.first == "and" || prev_form.first == "or")) {
+                            const auto& prev_prev_form = output_forms[i - 2];
+                            switch (prev_prev_form.second->part_of_speech) {
+                            case PART_OF_SPEECH_NOUN:
+                            case PART_OF_SPEECH_PRONOUN:
+                            case PART_OF_SPEECH_PARTICIPLE:
+                                if (word_features[i].can_be_noun_like(prev_prev_form.second->get_casus(), prev_prev_form.second->is_plural())) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.is_noun_like() &&
+                                                form.get_casus() == prev_prev_form.second->get_casus() &&
+                                                form.is_plural() == prev_prev_form.second->is_plural()) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_VERB:
+                                if (word_features[i].can_be_verb(prev_prev_form.second->is_plural())) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.part_of_speech == PART_OF_SPEECH_VERB &&
+                                                form.is_plural() == prev_prev_form.second->is_plural()) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_ADJECTIVE:
+                                if (word_features[i].can_be_adjective(prev_prev_form.second->get_casus(), prev_prev_form.second->is_plural(), prev_prev_form.second->get_gender())) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
+                                                form.get_casus() == prev_prev_form.second->get_casus() &&
+                                                form.is_plural() == prev_prev_form.second->is_plural() &&
+                                                form.get_gender() == prev_prev_form.second->get_gender()) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_ADVERB:
+                                if (word_features[i].can_be(PART_OF_SPEECH_ADVERB)) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.part_of_speech == PART_OF_SPEECH_ADVERB) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            default:
+                                break;
+                            }
+                        }
+                        break;
+
+                    case PART_OF_SPEECH_PREPOSITION:
+                        if (word_features[i].can_be_noun_like(prev_form.second->get_casus())) {
+                            for (const auto& variant : current_word) {
+                                for (const auto& form : current_word.forms(variant)) {
+                                    if (form.is_noun_like() && form.get_casus() == prev_form.second->get_casus()) {
+                                        resolve_word(i, variant, form);
+                                        goto next_form;
+                                    }
+                                }
+                            }
+                        }
+                        break;
+
+                    case PART_OF_SPEECH_NOUN:
+                    case PART_OF_SPEECH_PRONOUN:
+                    case PART_OF_SPEECH_PARTICIPLE:
+                        if (word_features[i].can_be_adjective(prev_form.second->get_casus(), prev_form.second->is_plural(), prev_form.second->get_gender())) {
+                            for (const auto& variant : current_word) {
+                                for (const auto& form : current_word.forms(variant)) {
+                                    if (form.part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
+                                        form.get_casus() == prev_form.second->get_casus() &&
+                                        form.is_plural() == prev_form.second->is_plural() &&
+                                        form.get_gender() == prev_form.second->get_gender()) {
+                                        resolve_word(i, variant, form);
+                                        goto next_form;
+                                    }
+                                }
+                            }
+                        }
+                        break;
+
+                    case PART_OF_SPEECH_ADVERB:
+                        if (word_features[i].can_be(PART_OF_SPEECH_VERB)) {
+                            for (const auto& variant : current_word) {
+                                for (const auto& form : current_word.forms(variant)) {
+                                    if (form.part_of_speech == PART_OF_SPEECH_VERB) {
+                                        resolve_word(i, variant, form);
+                                        goto next_form;
+                                    }
+                                }
+                            }
+                        }
+                        break;
+
+                    default:
+                        break;
+                    }
+                }
+
+                if (i != output_forms.size() - 1 &&
+                    output_forms[i + 1].second &&
+                    !split_input_sentence[i].trailing_punctuation &&
+                    !split_input_sentence[i + 1].trailing_punctuation) {
+                    const auto& next_form = output_forms[i + 1];
+                    switch (next_form.second->part_of_speech) {
+                    case PART_OF_SPEECH_CONJUNCTION:
+                        if ((next_form.first == "and" || next_form.first == "or") && i != output_forms.size() - 2 && output_forms[i + 2].second) {
+                            const auto& next_next_form = output_forms[i + 2];
+                            switch (next_next_form.second->part_of_speech) {
+                            case PART_OF_SPEECH_NOUN:
+                            case PART_OF_SPEECH_PRONOUN:
+                            case PART_OF_SPEECH_PARTICIPLE:
+                                if (word_features[i].can_be_noun_like(next_next_form.second->get_casus(), next_next_form.second->is_plural())) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.is_noun_like() &&
+                                                form.get_casus() == next_next_form.second->get_casus() &&
+                                                form.is_plural() == next_next_form.second->is_plural()) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_VERB:
+                                if (word_features[i].can_be_verb(next_next_form.second->is_plural())) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.part_of_speech == PART_OF_SPEECH_VERB &&
+                                                form.is_plural() == next_next_form.second->is_plural()) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_ADJECTIVE:
+                                if (word_features[i].can_be_adjective(next_next_form.second->get_casus(), next_next_form.second->is_plural(), next_next_form.second->get_gender())) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
+                                                form.get_casus() == next_next_form.second->get_casus() &&
+                                                form.is_plural() == next_next_form.second->is_plural() &&
+                                                form.get_gender() == next_next_form.second->get_gender()) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_ADVERB:
+                                if (word_features[i].can_be(PART_OF_SPEECH_ADVERB)) {
+                                    for (const auto& variant : current_word) {
+                                        for (const auto& form : current_word.forms(variant)) {
+                                            if (form.part_of_speech == PART_OF_SPEECH_ADVERB) {
+                                                resolve_word(i, variant, form);
+                                                goto next_form;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            default:
+                                break;
+                            }
+                        }
+                        break;
+
+                    case PART_OF_SPEECH_NOUN:
+                    case PART_OF_SPEECH_PRONOUN:
+                    case PART_OF_SPEECH_PARTICIPLE:
+                        if (word_features[i].can_be_preposition(next_form.second->get_casus())) {
+                            for (const auto& variant : current_word) {
+                                for (const auto& form : current_word.forms(variant)) {
+                                    if (form.part_of_speech == PART_OF_SPEECH_PREPOSITION &&
+                                        form.get_casus() == next_form.second->get_casus()) {
+                                        resolve_word(i, variant, form);
+                                        goto next_form;
+                                    }
+                                }
+                            }
+                        }
+                        break;
+
+                    case PART_OF_SPEECH_ADJECTIVE:
+                        if (word_features[i].can_be_noun_like(next_form.second->get_casus(), next_form.second->is_plural(), next_form.second->get_gender())) {
+                            for (const auto& variant : current_word) {
+                                for (const auto& form : current_word.forms(variant)) {
+                                    if (form.is_noun_like() &&
+                                        form.get_casus() == next_form.second->get_casus() &&
+                                        form.is_plural() == next_form.second->is_plural() &&
+                                        form.get_gender() == next_form.second->get_gender()) {
+                                        resolve_word(i, variant, form);
+                                        goto next_form;
+                                    }
+                                }
+                            }
+                        }
+                        break;
+
+                    case PART_OF_SPEECH_VERB:
+                        if (word_features[i].can_be(PART_OF_SPEECH_ADVERB)) {
+                            for (const auto& variant : current_word) {
+                                for (const auto& form : current_word.forms(variant)) {
+                                    if (form.part_of_speech == PART_OF_SPEECH_ADVERB) {
+                                        resolve_word(i, variant, form);
+                                        goto next_form;
+                                    }
+                                }
+                            }
+                        }
+                        break;
+
+                    default:
+                        break;
+                    }
+                }
+            }
+
+            continue;
+
+        next_form:
+            resolved = true;
+        }
+        if (resolved) {
+            goto next_cycle;
+        }
+
+        // PHASE 2.2: RESOLVE SETS OF UNKNOWNS USING COMMONALITIES
+        for (size_t i = commonality_candidates.next(0); i < output_forms.size() - 1; i = commonality_candidates.next(i + 1)) {
+            commonality_candidates.erase(i);
+            const auto& current_form = output_forms[i];
+            const auto& next_form = output_forms[i + 1];
+            if (current_form.second) {
+                if (i &&
+                    current_form.second->part_of_speech == PART_OF_SPEECH_CONJUNCTION &&
+                    (current_form.first == "and" || current_form.first == "or") &&
+                    !output_forms[i - 1].second &&
+                    !next_form.second &&
+                    !split_input_sentence[i - 1].trailing_punctuation &&
+                    !split_input_sentence[i].trailing_punctuation) {
+                    const auto& prev_word = input_words[i - 1];
+                    for (const auto& variant_a : prev_word) {
+                        for (const auto& form_a : prev_word.forms(variant_a)) {
+                            const auto& next_word = input_words[i + 1];
+                            switch (form_a.part_of_speech) {
+                            case PART_OF_SPEECH_NOUN:
+                            case PART_OF_SPEECH_PRONOUN:
+                            case PART_OF_SPEECH_PARTICIPLE:
+                                if (word_features[i + 1].can_be_noun_like(form_a.get_casus(), form_a.is_plural())) {
+                                    for (const auto& variant_b : next_word) {
+                                        for (const auto& form_b : next_word.forms(variant_b)) {
+                                            if (form_b.is_noun_like() &&
+                                                form_a.get_casus() == form_b.get_casus() &&
+                                                form_a.is_plural() == form_b.is_plural()) {
+                                                resolve_word(i - 1, variant_a, form_a);
+                                                resolve_word(i + 1, variant_b, form_b);
+                                                goto next_cycle;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_VERB:
+                                if (word_features[i + 1].can_be_verb(form_a.is_plural())) {
+                                    for (const auto& variant_b : next_word) {
+                                        for (const auto& form_b : next_word.forms(variant_b)) {
+                                            if (form_b.part_of_speech == PART_OF_SPEECH_VERB &&
+                                                form_a.is_plural() == form_b.is_plural()) {
+                                                resolve_word(i - 1, variant_a, form_a);
+                                                resolve_word(i + 1, variant_b, form_b);
+                                                goto next_cycle;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_ADJECTIVE:
+                                if (word_features[i + 1].can_be_adjective(form_a.get_casus(), form_a.is_plural(), form_a.get_gender())) {
+                                    for (const auto& variant_b : next_word) {
+                                        for (const auto& form_b : next_word.forms(variant_b)) {
+                                            if (form_b.part_of_speech == PART_OF_SPEECH_ADJECTIVE &&
+                                                form_a.get_casus() == form_b.get_casus() &&
+                                                form_a.is_plural() == form_b.is_plural() &&
+                                                form_a.get_gender() == form_b.get_gender()) {
+                                                resolve_word(i - 1, variant_a, form_a);
+                                                resolve_word(i + 1, variant_b, form_b);
+                                                goto next_cycle;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            case PART_OF_SPEECH_ADVERB:
+                                if (word_features[i + 1].can_be(PART_OF_SPEECH_ADVERB)) {
+                                    for (const auto& variant_b : next_word) {
+                                        for (const auto& form_b : next_word.forms(variant_b)) {
+                                            if (form_b.part_of_speech == PART_OF_SPEECH_ADVERB) {
+                                                resolve_word(i - 1, variant_a, form_a);
+                                                resolve_word(i + 1, variant_b, form_b);
+                                                goto next_cycle;
+                                            }
+                                        }
+                                    }
+                                }
+                                break;
+
+                            default:
+                                break;
+                            }
+                        }
+                    }
+                }
+            } else if (!next_form.second) {
+                const auto& current_word = input_words[i];
+                if (word_features[i].can_be(PART_OF_SPEECH_PREPOSITION)) {
+                    for (const auto& variant_a : current_word) {
+                        for (const auto& form_a : current_word.forms(variant_a)) {
+                            if (form_a.part_of_speech == PART_OF_SPEECH_PREPOSITION) {
+                                const auto& next_word = input_words[i + 1];
+                                if (word_features[i + 1].can_be_noun_like(form_a.get_casus())) {
+                                    for (const auto& variant_b : next_word) {
+                                        for (const auto& form_b : next_word.forms(variant_b)) {
+                                            if (form_b.is_noun_like() && form_a.get_casus() == form_b.get_casus()) {
+                                                resolve_word(i, variant_a, form_a);
+                                                resolve_word(i + 1, variant_b, form_b);
+                                                goto next_cycle;
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // PHASE 2.3: NAIVELY DISCOVER ADVERBS
+        for (size_t i = adverb_candidates.next(0); i < output_forms.size(); i = adverb_candidates.next(i + 1)) {
+            adverb_candidates.erase(i);
+            const auto& current_form = output_forms[i];
+            if (!current_form.second) {
+                const auto& current_word = input_words[i];
+                if (word_features[i].can_be(PART_OF_SPEECH_ADVERB)) {
+                    for (const auto& variant : current_word) {
+                        for (const auto& form : current_word.forms(variant)) {
+                            if (form.part_of_speech == PART_OF_SPEECH_ADVERB) {
+                                resolve_word(i, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // PHASE 2.4: NAIVELY DISCOVER GENITIVES, DATIVES, AND ABLATIVES AFTER OTHER NOUN-LIKES
+        for (size_t i = case_candidates.next(0); i < output_forms.size() - 1; i = case_candidates.next(i + 1)) {
+            case_candidates.erase(i);
+            const auto& current_form = output_forms[i];
+            const auto& next_form = output_forms[i + 1];
+            if (current_form.second && current_form.second->is_noun_like() && !next_form.second) {
+                const auto& next_word = input_words[i + 1];
+
+                // Check for genitives
+                if (word_features[i + 1].can_be_noun_like(CASUS_GENITIVE)) {
+                    for (const auto& variant : next_word) {
+                        for (const auto& form : next_word.forms(variant)) {
+                            if (form.is_noun_like() && form.get_casus() == CASUS_GENITIVE) {
+                                resolve_word(i + 1, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+
+                // Check for datives
+                if (word_features[i + 1].can_be_noun_like(CASUS_DATIVE)) {
+                    for (const auto& variant : next_word) {
+                        for (const auto& form : next_word.forms(variant)) {
+                            if (form.is_noun_like() && form.get_casus() == CASUS_DATIVE) {
+                                resolve_word(i + 1, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+
+                // Check for ablatives
+                if (word_features[i + 1].can_be_noun_like(CASUS_ABLATIVE)) {
+                    for (const auto& variant : next_word) {
+                        for (const auto& form : next_word.forms(variant)) {
+                            if (form.is_noun_like() && form.get_casus() == CASUS_ABLATIVE) {
+                                resolve_word(i + 1, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // PHASE 2.5: NAIVELY DISCOVER SUBJECTS, OBJECTS, AND VERBS
+        for (size_t i = subject_object_verb_candidates.next(0); i < output_forms.size(); i = subject_object_verb_candidates.next(i + 1)) {
+            subject_object_verb_candidates.erase(i);
+            const auto& current_form = output_forms[i];
+            if (!current_form.second) {
+                const auto& current_word = input_words[i];
+
+                // Check for subjects
+                if (word_features[i].can_be_noun_like(CASUS_NOMINATIVE)) {
+                    for (const auto& variant : current_word) {
+                        for (const auto& form : current_word.forms(variant)) {
+                            if (form.is_noun_like() && form.get_casus() == CASUS_NOMINATIVE) {
+                                resolve_word(i, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+
+                // Check for objects
+                if (word_features[i].can_be_noun_like(CASUS_ACCUSATIVE)) {
+                    for (const auto& variant : current_word) {
+                        for (const auto& form : current_word.forms(variant)) {
+                            if (form.is_noun_like() && form.get_casus() == CASUS_ACCUSATIVE) {
+                                resolve_word(i, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+
+                // Check for verbs
+                if (word_features[i].can_be(PART_OF_SPEECH_VERB)) {
+                    for (const auto& variant : current_word) {
+                        for (const auto& form : current_word.forms(variant)) {
+                            if (form.part_of_speech == PART_OF_SPEECH_VERB) {
+                                resolve_word(i, variant, form);
+                                goto next_cycle;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // PHASE 2.6: PICK THE TOP FORM FOR REMAINING UNKNOWNS
+        for (size_t i = top_form_candidates.next(0); i < output_forms.size(); i = top_form_candidates.next(i + 1)) {
+            top_form_candidates.erase(i);
+            const auto& current_form = output_forms[i];
+            if (!current_form.second) {
+                resolve_word(i, input_words[i].front(), input_words[i].forms(input_words[i].front()).front());
+                goto next_cycle;
+            }
+        }
+
+        continue;
+
+    next_cycle:
+        resolved = true;
+    } while (resolved);
+    thread_metrics().resolver_iterations.observe(iterations);
+}
+
+void SentenceAnalyzer::resolve_beam(Result& ret) {
+    static constexpr size_t beam_width = 16;
+    const auto& split_input_sentence = ret.tokens;
+    const auto& input_words = ret.words;
+    auto& output_forms = ret.forms;
+    output_forms.resize(input_words.size());
+    if (input_words.empty()) {
+        return;
+    }
+
+    beam_candidates.clear();
+    beam_candidate_offsets.clear();
+    for (const auto& word : input_words) {
+        beam_candidate_offsets.push_back(beam_candidates.size());
+        for (const auto& variant : word) {
+            bool coordinating = variant.english_base == "and" || variant.english_base == "or";
+            for (const auto& form : word.forms(variant)) {
+                beam_candidates.push_back({&variant, form, preference_score(form), coordinating && form.part_of_speech == PART_OF_SPEECH_CONJUNCTION});
+            }
+        }
+    }
+    beam_candidate_offsets.push_back(beam_candidates.size());
+
+    // Extend every path ending at the previous word by every candidate of this word, then keep the best beam_width paths
+    // Paths that end at the same candidate are merged, except at "and" or "or", where the word before still matters to the word after
+    beam_paths.clear();
+    beam_path_offsets.clear();
+    for (size_t i = 0; i < input_words.size(); ++i) {
+        size_t paths_begin = beam_paths.size();
+        beam_path_offsets.push_back(paths_begin);
+        for (uint32_t c = beam_candidate_offsets[i]; c < beam_candidate_offsets[i + 1]; ++c) {
+            const auto& candidate = beam_candidates[c];
+            if (!i) {
+                beam_paths.push_back({candidate.score, c, UINT32_MAX});
+                continue;
+            }
+
+            size_t candidate_paths_begin = beam_paths.size();
+            for (uint32_t p = beam_path_offsets[i - 1]; p < paths_begin; ++p) {
+                const auto& prev_path = beam_paths[p];
+                const auto& prev_candidate = beam_candidates[prev_path.candidate];
+
+                int score = prev_path.score + candidate.score;
+                if (!split_input_sentence[i - 1].trailing_punctuation) {
+                    score += adjacency_score(prev_candidate.form, candidate.form);
+                    if (prev_candidate.coordinating && prev_path.prev != UINT32_MAX && !split_input_sentence[i - 2].trailing_punctuation) {
+                        score += coordination_score(beam_candidates[beam_paths[prev_path.prev].candidate].form, candidate.form);
+                    }
+                }
+
+                if (candidate.coordinating || beam_paths.size() == candidate_paths_begin) {
+                    beam_paths.push_back({score, c, p});
+                } else if (score > beam_paths.back().score) {
+                    beam_paths.back() = {score, c, p};
+                }
+            }
+        }
+
+        if (beam_paths.size() - paths_begin > beam_width) {
+            std::partial_sort(beam_paths.begin() + paths_begin, beam_paths.begin() + paths_begin + beam_width, beam_paths.end(), [](const auto& a, const auto& b) {
+                if (a.score != b.score) {
+                    return a.score > b.score;
+                } else if (a.candidate != b.candidate) {
+                    return a.candidate < b.candidate; // Prefer earlier forms, like phase 2.6 of the greedy engine does
+                }
+                return a.prev < b.prev;
+            });
+            beam_paths.resize(paths_begin + beam_width);
+        }
+    }
+
+    // Follow the best complete path back to the start of the sentence
+    uint32_t path = std::max_element(beam_paths.begin() + beam_path_offsets.back(), beam_paths.end(), [](const auto& a, const auto& b) {
+        return a.score < b.score;
+    }) - beam_paths.begin();
+    for (size_t i = input_words.size(); i-- > 0; path = beam_paths[path].prev) {
+        const auto& candidate = beam_candidates[beam_paths[path].candidate];
+        output_forms[i] = {candidate.variant->english_base, candidate.form};
+    }
+}
+
+void SentenceAnalyzer::render(Result& ret) const {
+    StageTimer timer(STAGE_RENDERING);
+    const auto& split_input_sentence = ret.tokens;
+    const auto& output_forms = ret.forms;
+    ret.ir.clear();
+
+    size_t size = output_forms.empty() ? 0 : (output_forms.size() - 1) * 3; // The <S> separators
+    for (size_t i = 0; i < output_forms.size(); ++i) {
+        size += split_input_sentence[i].leading_punctuation + split_input_sentence[i].trailing_punctuation + tokenize(*output_forms[i].second).size() + output_forms[i].first.size();
+    }
+    ret.ir.reserve(size);
+
+    for (size_t i = 0; i < output_forms.size(); ++i) {
+        const auto& token = split_input_sentence[i];
+        if (i) {
+            ret.ir += "<S>";
+        }
+        ret.ir += token.text.substr(0, token.leading_punctuation);
+        ret.ir += tokenize(*output_forms[i].second);
+        ret.ir += output_forms[i].first;
+        ret.ir += token.text.substr(token.text.size() - token.trailing_punctuation);
+    }
+}
+
+void analyze_sentences(WorkerPool& pool, const std::vector<std::string_view>& sentences, std::vector<std::optional<std::string>>& ret, ResolutionEngine engine) {
+    ret.assign(sentences.size(), std::nullopt);
+    pool.parallel_for(sentences.size(), [&sentences, &ret, engine](size_t i) {
+        thread_local SentenceAnalyzer analyzer;
+        thread_local SentenceAnalyzer::Result result;
+
+        // One bad sentence shouldn't take the rest of the batch down with it
+        try {
+            if (analyzer.analyze(sentences[i], result, engine)) {
+                ret[i] = result.ir;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: Failed to analyze sentence: " << e.what() << std::endl;
+        }
+    });
+}
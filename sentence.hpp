@@ -0,0 +1,116 @@
+#pragma once
+
+#include "dictionary.hpp"
+#include "features.hpp"
+#include "word_set.hpp"
+#include "words.hpp"
+#include "worker_pool.hpp"
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The English base and form picked for a word, if any
+typedef std::pair<std::string, std::optional<WordForm>> ResolvedWord;
+
+enum ResolutionEngine {
+    RESOLUTION_ENGINE_GREEDY, // Applies the agreement rules one word at a time, committing to the first form that fits
+    RESOLUTION_ENGINE_BEAM,   // Scores whole paths through every word's forms with the same rules, and keeps the best ones
+};
+
+// Resolves every word of a Latin sentence to a single form, and renders the result in the intermediate representation
+// Results go into a caller-owned Result, so its buffers can be reused from one sentence to the next
+// Analyzers aren't thread-safe, so each thread should have its own
+class SentenceAnalyzer {
+public:
+    // A word of the sentence, still with its punctuation
+    // Points into the transliterated sentence, or at a static string for clitics that were split off into their own words
+    struct Token {
+        std::string_view text;
+        uint32_t leading_punctuation = 0;
+        uint32_t trailing_punctuation = 0;
+        uint32_t clitic = 0; // The length of a trailing -que, -cum, or -ne, which is split off if the whole word can't be found
+
+        // The text without its leading and trailing punctuation
+        std::string_view word() const {
+            if (leading_punctuation + trailing_punctuation >= text.size()) {
+                return {};
+            }
+            return text.substr(leading_punctuation, text.size() - leading_punctuation - trailing_punctuation);
+        }
+    };
+
+    struct Result {
+        std::string text; // The transliterated sentence, which tokens point into
+        std::vector<Token> tokens;
+        std::vector<VariantsView> words;
+        std::vector<ResolvedWord> forms;
+        std::string ir;
+
+        // Copies and moves keep tokens pointing into their own result's text
+        Result() = default;
+        Result(const Result& other);
+        Result(Result&& other);
+        Result& operator=(const Result& other);
+        Result& operator=(Result&& other);
+
+    protected:
+        void rebase_tokens(const char* old_text, size_t old_size);
+    };
+
+protected:
+    Transliterator transliterator;
+    std::vector<FeatureSet> word_features;
+    WordSet phase_candidates[6]; // The words each of phases 2.1 to 2.6 could still pick
+    std::string stripped_word;
+
+    // The distinct words of the sentence being looked up, which are all queried up front in batches
+    std::vector<std::string> lookup_words;
+    std::vector<VariantsView> lookup_results;
+    std::vector<std::string> clitic_lookup_words;
+    std::vector<VariantsView> clitic_lookup_results;
+
+    // Every (variant, form) pair of every word, laid out word by word, for the beam engine
+    struct BeamCandidate {
+        const WordVariant* variant;
+        WordForm form;
+        int score;         // How likely the form is on its own
+        bool coordinating; // Whether the form is "and" or "or", which links the words on either side of it
+    };
+    // A partial path through the sentence that ends at candidate, and continues backwards from prev
+    struct BeamPath {
+        int score;
+        uint32_t candidate;
+        uint32_t prev;
+    };
+    std::vector<BeamCandidate> beam_candidates;
+    std::vector<size_t> beam_candidate_offsets;
+    std::vector<BeamPath> beam_paths;
+    std::vector<size_t> beam_path_offsets;
+
+    void prefetch(const std::vector<Token>& tokens);
+    bool find_prefetched(const std::string& word, VariantsView& ret) const;
+    bool analyze_tokens(Result& ret, ResolutionEngine engine);
+    void resolve_greedy(Result& ret);
+    void resolve_beam(Result& ret);
+
+public:
+    // Returns false if the sentence is empty or a word can't be found in the dictionary
+    bool analyze(std::string_view sentence, Result& ret, ResolutionEngine engine = RESOLUTION_ENGINE_GREEDY);
+    // Same as above, but for a sentence that has already been split into words
+    bool analyze(const std::vector<std::string>& tokens, Result& ret, ResolutionEngine engine = RESOLUTION_ENGINE_GREEDY);
+
+    // The stages of analyze, which can also be run on their own (e.g. for benchmarking)
+    // split fills in text and tokens from the sentence, lookup fills in words from tokens, resolve fills in forms from words, and render fills in ir from forms
+    void split(std::string_view sentence, Result& ret);
+    bool lookup(Result& ret);
+    void resolve(Result& ret, ResolutionEngine engine = RESOLUTION_ENGINE_GREEDY);
+    void render(Result& ret) const;
+};
+
+// Analyzes many sentences across a worker pool, keeping the results in input order
+// Sentences that can't be analyzed are left empty
+void analyze_sentences(WorkerPool& pool, const std::vector<std::string_view>& sentences, std::vector<std::optional<std::string>>& ret, ResolutionEngine engine = RESOLUTION_ENGINE_GREEDY);
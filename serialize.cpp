@@ -1,212 +1,178 @@
 #include "json.hpp"
 #include "words.hpp"
+#include <iterator>
+#include <stddef.h>
 #include <stdexcept>
+#include <stdio.h>
+#include <string>
+#include <string_view>
 
 using nlohmann::json;
 
-json WordForm::to_json() const {
-    json ret;
-
-    switch (part_of_speech) {
-    case PART_OF_SPEECH_NOUN: ret["part_of_speech"] = "noun"; break;
-    case PART_OF_SPEECH_VERB: ret["part_of_speech"] = "verb"; break;
-    case PART_OF_SPEECH_PARTICIPLE: ret["part_of_speech"] = "participle"; break;
-    case PART_OF_SPEECH_SUPINE: ret["part_of_speech"] = "supine"; break;
-    case PART_OF_SPEECH_ADJECTIVE: ret["part_of_speech"] = "adjective"; break;
-    case PART_OF_SPEECH_ADVERB: ret["part_of_speech"] = "adverb"; break;
-    case PART_OF_SPEECH_PRONOUN: ret["part_of_speech"] = "pronoun"; break;
-    case PART_OF_SPEECH_CONJUNCTION: ret["part_of_speech"] = "conjunction"; break;
-    case PART_OF_SPEECH_PREPOSITION: ret["part_of_speech"] = "preposition"; break;
-    case PART_OF_SPEECH_INTERJECTION: ret["part_of_speech"] = "interjection"; break;
-    case PART_OF_SPEECH_NUMERAL: ret["part_of_speech"] = "numeral"; break;
-    }
-
-    return ret;
+// The names of each feature's values, indexed by the feature (NONE has no name)
+constexpr std::string_view part_of_speech_names[] = {"noun", "verb", "participle", "supine", "adjective", "adverb", "pronoun", "conjunction", "preposition", "interjection", "numeral"};
+constexpr std::string_view casus_names[] = {"nominative", "genitive", "dative", "accusative", "ablative", "vocative", "locative"};
+constexpr std::string_view gender_names[] = {"masculine", "feminine", "neuter", "common"};
+constexpr std::string_view tense_names[] = {"present", "imperfect", "perfect", "pluperfect", "future", "future_perfect"};
+constexpr std::string_view voice_names[] = {"active", "passive"};
+constexpr std::string_view mood_names[] = {"indicative", "subjunctive", "imperative", "infinitive"};
+constexpr std::string_view degree_names[] = {"positive", "comparative", "superlative"};
+constexpr std::string_view numeral_type_names[] = {"cardinal", "ordinal", "distributive", "adverb"};
+
+static_assert(std::size(part_of_speech_names) == PART_OF_SPEECH_NUMERAL + 1, "Every part of speech must have a name");
+static_assert(std::size(casus_names) == CASUS_NONE, "Every case must have a name");
+static_assert(std::size(gender_names) == GENDER_NONE, "Every gender must have a name");
+static_assert(std::size(tense_names) == TENSE_NONE, "Every tense must have a name");
+static_assert(std::size(voice_names) == VOICE_NONE, "Every voice must have a name");
+static_assert(std::size(mood_names) == MOOD_NONE, "Every mood must have a name");
+static_assert(std::size(degree_names) == DEGREE_NONE, "Every degree must have a name");
+static_assert(std::size(numeral_type_names) == NUMERAL_TYPE_NONE, "Every numeral type must have a name");
+
+template <size_t N>
+std::string_view get_name(const std::string_view (&names)[N], int value, const char* error) {
+    if (value < 0 || (size_t) value >= N) {
+        throw std::logic_error(error);
+    }
+    return names[value];
 }
 
-json Noun::to_json() const {
-    json ret = WordForm::to_json();
-
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret["casus"] = "nominative"; break;
-    case CASUS_GENITIVE: ret["casus"] = "genitive"; break;
-    case CASUS_DATIVE: ret["casus"] = "dative"; break;
-    case CASUS_ACCUSATIVE: ret["casus"] = "accusative"; break;
-    case CASUS_ABLATIVE: ret["casus"] = "ablative"; break;
-    case CASUS_VOCATIVE: ret["casus"] = "vocative"; break;
-    case CASUS_LOCATIVE: ret["casus"] = "locative"; break;
-    default: throw std::logic_error("Invalid case");
-    }
-
-    ret["plural"] = plural;
-
-    switch (gender) {
-    case GENDER_MASCULINE: ret["gender"] = "masculine"; break;
-    case GENDER_FEMININE: ret["gender"] = "feminine"; break;
-    case GENDER_NEUTER: ret["gender"] = "neuter"; break;
-    case GENDER_COMMON: ret["gender"] = "common"; break;
-    default: throw std::logic_error("Invalid gender");
+// The features each part of speech's forms are serialized with
+enum FormField {
+    FORM_FIELD_CASUS = 1 << 0,
+    FORM_FIELD_DEGREE = 1 << 1,
+    FORM_FIELD_GENDER = 1 << 2,
+    FORM_FIELD_MOOD = 1 << 3,
+    FORM_FIELD_PERSON = 1 << 4,
+    FORM_FIELD_PLURAL = 1 << 5,
+    FORM_FIELD_TENSE = 1 << 6,
+    FORM_FIELD_TYPE = 1 << 7,
+    FORM_FIELD_VOICE = 1 << 8,
+};
+
+constexpr unsigned form_fields[] = {
+    FORM_FIELD_CASUS | FORM_FIELD_GENDER | FORM_FIELD_PLURAL,                                         // Noun
+    FORM_FIELD_MOOD | FORM_FIELD_PERSON | FORM_FIELD_PLURAL | FORM_FIELD_TENSE | FORM_FIELD_VOICE,    // Verb
+    FORM_FIELD_CASUS | FORM_FIELD_GENDER | FORM_FIELD_PLURAL | FORM_FIELD_TENSE | FORM_FIELD_VOICE,   // Participle
+    FORM_FIELD_CASUS | FORM_FIELD_GENDER | FORM_FIELD_PLURAL,                                         // Supine
+    FORM_FIELD_CASUS | FORM_FIELD_DEGREE | FORM_FIELD_GENDER | FORM_FIELD_PLURAL,                     // Adjective
+    FORM_FIELD_DEGREE,                                                                                // Adverb
+    FORM_FIELD_CASUS | FORM_FIELD_GENDER | FORM_FIELD_PLURAL,                                         // Pronoun
+    0,                                                                                                // Conjunction
+    FORM_FIELD_CASUS,                                                                                 // Preposition
+    0,                                                                                                // Interjection
+    FORM_FIELD_CASUS | FORM_FIELD_GENDER | FORM_FIELD_PLURAL | FORM_FIELD_TYPE,                       // Numeral
+};
+
+static_assert(std::size(form_fields) == std::size(part_of_speech_names), "Every part of speech must have fields");
+
+void to_json(json& ret, const WordForm& form) {
+    ret = json::object();
+
+    ret["part_of_speech"] = get_name(part_of_speech_names, form.part_of_speech, "Invalid part of speech");
+    unsigned fields = form_fields[form.part_of_speech];
+    if (fields & FORM_FIELD_CASUS) {
+        ret["casus"] = get_name(casus_names, form.casus, "Invalid case");
+    }
+    if (fields & FORM_FIELD_DEGREE) {
+        ret["degree"] = get_name(degree_names, form.degree, "Invalid degree");
+    }
+    if (fields & FORM_FIELD_GENDER) {
+        ret["gender"] = get_name(gender_names, form.gender, "Invalid gender");
+    }
+    if (fields & FORM_FIELD_MOOD) {
+        ret["mood"] = get_name(mood_names, form.mood, "Invalid mood");
+    }
+    if (fields & FORM_FIELD_PERSON) {
+        ret["person"] = form.person + 1;
+    }
+    if (fields & FORM_FIELD_PLURAL) {
+        ret["plural"] = (bool) form.plural;
+    }
+    if (fields & FORM_FIELD_TENSE) {
+        ret["tense"] = get_name(tense_names, form.tense, "Invalid tense");
+    }
+    if (fields & FORM_FIELD_TYPE) {
+        ret["type"] = get_name(numeral_type_names, form.numeral_type, "Invalid type");
+    }
+    if (fields & FORM_FIELD_VOICE) {
+        ret["voice"] = get_name(voice_names, form.voice, "Invalid voice");
     }
-
-    return ret;
 }
 
-json Verb::to_json() const {
-    json ret = WordForm::to_json();
-
-    switch (tense) {
-    case TENSE_PRESENT: ret["tense"] = "present"; break;
-    case TENSE_IMPERFECT: ret["tense"] = "imperfect"; break;
-    case TENSE_PERFECT: ret["tense"] = "perfect"; break;
-    case TENSE_PLUPERFECT: ret["tense"] = "pluperfect"; break;
-    case TENSE_FUTURE: ret["tense"] = "future"; break;
-    case TENSE_FUTURE_PERFECT: ret["tense"] = "future_perfect"; break;
-    default: throw std::logic_error("Invalid tense");
-    }
-
-    switch (voice) {
-    case VOICE_ACTIVE: ret["voice"] = "active"; break;
-    case VOICE_PASSIVE: ret["voice"] = "passive"; break;
-    default: throw std::logic_error("Invalid voice");
-    }
-
-    switch (mood) {
-    case MOOD_INDICATIVE: ret["mood"] = "indicative"; break;
-    case MOOD_SUBJUNCTIVE: ret["mood"] = "subjunctive"; break;
-    case MOOD_IMPERATIVE: ret["mood"] = "imperative"; break;
-    case MOOD_INFINITIVE: ret["mood"] = "infinitive"; break;
-    default: throw std::logic_error("Invalid mood");
-    }
-
-    ret["person"] = person + 1;
-    ret["plural"] = plural;
-
-    return ret;
+void serialize_string(std::string& ret, std::string_view str) {
+    ret.push_back('"');
+    for (char c : str) {
+        switch (c) {
+        case '"': ret += "\\\""; break;
+        case '\\': ret += "\\\\"; break;
+        case '\b': ret += "\\b"; break;
+        case '\f': ret += "\\f"; break;
+        case '\n': ret += "\\n"; break;
+        case '\r': ret += "\\r"; break;
+        case '\t': ret += "\\t"; break;
+        default:
+            if ((unsigned char) c < 0x20) {
+                char escape[7];
+                snprintf(escape, sizeof escape, "\\u%04x", c);
+                ret += escape;
+            } else {
+                ret.push_back(c);
+            }
+            break;
+        }
+    }
+    ret.push_back('"');
 }
 
-json Participle::to_json() const {
-    json ret = WordForm::to_json();
+// Names never need escaping
+void serialize_field(std::string& ret, std::string_view key, std::string_view name) {
+    ret += ",\"";
+    ret += key;
+    ret += "\":\"";
+    ret += name;
+    ret.push_back('"');
+}
 
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret["casus"] = "nominative"; break;
-    case CASUS_GENITIVE: ret["casus"] = "genitive"; break;
-    case CASUS_DATIVE: ret["casus"] = "dative"; break;
-    case CASUS_ACCUSATIVE: ret["casus"] = "accusative"; break;
-    case CASUS_ABLATIVE: ret["casus"] = "ablative"; break;
-    case CASUS_VOCATIVE: ret["casus"] = "vocative"; break;
-    case CASUS_LOCATIVE: ret["casus"] = "locative"; break;
-    default: throw std::logic_error("Invalid case");
+void serialize_form(std::string& ret, const WordForm& form, std::string_view english_equivalent) {
+    // Fields are written in alphabetical order, matching nlohmann::json's sorted objects
+    // english_equivalent always comes third at the latest, so it anchors the commas
+    std::string_view part_of_speech = get_name(part_of_speech_names, form.part_of_speech, "Invalid part of speech");
+    unsigned fields = form_fields[form.part_of_speech];
+    ret.push_back('{');
+    if (fields & FORM_FIELD_CASUS) {
+        ret += "\"casus\":\"";
+        ret += get_name(casus_names, form.casus, "Invalid case");
+        ret += "\",";
     }
-
-    ret["plural"] = plural;
-
-    switch (gender) {
-    case GENDER_MASCULINE: ret["gender"] = "masculine"; break;
-    case GENDER_FEMININE: ret["gender"] = "feminine"; break;
-    case GENDER_NEUTER: ret["gender"] = "neuter"; break;
-    case GENDER_COMMON: ret["gender"] = "common"; break;
-    default: throw std::logic_error("Invalid gender");
+    if (fields & FORM_FIELD_DEGREE) {
+        ret += "\"degree\":\"";
+        ret += get_name(degree_names, form.degree, "Invalid degree");
+        ret += "\",";
     }
-
-    switch (tense) {
-    case TENSE_PRESENT: ret["tense"] = "present"; break;
-    case TENSE_IMPERFECT: ret["tense"] = "imperfect"; break;
-    case TENSE_PERFECT: ret["tense"] = "perfect"; break;
-    case TENSE_PLUPERFECT: ret["tense"] = "pluperfect"; break;
-    case TENSE_FUTURE: ret["tense"] = "future"; break;
-    case TENSE_FUTURE_PERFECT: ret["tense"] = "future_perfect"; break;
-    default: throw std::logic_error("Invalid tense");
+    ret += "\"english_equivalent\":";
+    serialize_string(ret, english_equivalent);
+    if (fields & FORM_FIELD_GENDER) {
+        serialize_field(ret, "gender", get_name(gender_names, form.gender, "Invalid gender"));
     }
-
-    switch (voice) {
-    case VOICE_ACTIVE: ret["voice"] = "active"; break;
-    case VOICE_PASSIVE: ret["voice"] = "passive"; break;
-    default: throw std::logic_error("Invalid voice");
+    if (fields & FORM_FIELD_MOOD) {
+        serialize_field(ret, "mood", get_name(mood_names, form.mood, "Invalid mood"));
     }
-
-    return ret;
-}
-
-json Supine::to_json() const {
-    json ret = WordForm::to_json();
-
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret["casus"] = "nominative"; break;
-    case CASUS_GENITIVE: ret["casus"] = "genitive"; break;
-    case CASUS_DATIVE: ret["casus"] = "dative"; break;
-    case CASUS_ACCUSATIVE: ret["casus"] = "accusative"; break;
-    case CASUS_ABLATIVE: ret["casus"] = "ablative"; break;
-    case CASUS_VOCATIVE: ret["casus"] = "vocative"; break;
-    case CASUS_LOCATIVE: ret["casus"] = "locative"; break;
-    default: throw std::logic_error("Invalid case");
+    serialize_field(ret, "part_of_speech", part_of_speech);
+    if (fields & FORM_FIELD_PERSON) {
+        ret += ",\"person\":";
+        ret += std::to_string(form.person + 1);
     }
-
-    ret["plural"] = plural;
-
-    switch (gender) {
-    case GENDER_MASCULINE: ret["gender"] = "masculine"; break;
-    case GENDER_FEMININE: ret["gender"] = "feminine"; break;
-    case GENDER_NEUTER: ret["gender"] = "neuter"; break;
-    case GENDER_COMMON: ret["gender"] = "common"; break;
-    default: throw std::logic_error("Invalid gender");
+    if (fields & FORM_FIELD_PLURAL) {
+        ret += form.plural ? ",\"plural\":true" : ",\"plural\":false";
     }
-
-    return ret;
-}
-
-json Adjective::to_json() const {
-    json ret = Noun::to_json();
-
-    switch (degree) {
-    case DEGREE_POSITIVE: ret["degree"] = "positive"; break;
-    case DEGREE_COMPARATIVE: ret["degree"] = "comparative"; break;
-    case DEGREE_SUPERLATIVE: ret["degree"] = "superlative"; break;
-    default: throw std::logic_error("Invalid degree");
-    }
-
-    return ret;
-}
-
-json Adverb::to_json() const {
-    json ret = WordForm::to_json();
-
-    switch (degree) {
-    case DEGREE_POSITIVE: ret["degree"] = "positive"; break;
-    case DEGREE_COMPARATIVE: ret["degree"] = "comparative"; break;
-    case DEGREE_SUPERLATIVE: ret["degree"] = "superlative"; break;
-    default: throw std::logic_error("Invalid gender");
+    if (fields & FORM_FIELD_TENSE) {
+        serialize_field(ret, "tense", get_name(tense_names, form.tense, "Invalid tense"));
     }
-
-    return ret;
-}
-
-json Preposition::to_json() const {
-    json ret = WordForm::to_json();
-
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret["casus"] = "nominative"; break;
-    case CASUS_GENITIVE: ret["casus"] = "genitive"; break;
-    case CASUS_DATIVE: ret["casus"] = "dative"; break;
-    case CASUS_ACCUSATIVE: ret["casus"] = "accusative"; break;
-    case CASUS_ABLATIVE: ret["casus"] = "ablative"; break;
-    case CASUS_VOCATIVE: ret["casus"] = "vocative"; break;
-    case CASUS_LOCATIVE: ret["casus"] = "locative"; break;
-    default: throw std::logic_error("Invalid case");
+    if (fields & FORM_FIELD_TYPE) {
+        serialize_field(ret, "type", get_name(numeral_type_names, form.numeral_type, "Invalid type"));
     }
-
-    return ret;
-}
-
-json Numeral::to_json() const {
-    json ret = Noun::to_json();
-
-    switch (type) {
-    case NUMERAL_TYPE_CARDINAL: ret["type"] = "cardinal"; break;
-    case NUMERAL_TYPE_ORDINAL: ret["type"] = "ordinal"; break;
-    case NUMERAL_TYPE_DISTRIBUTIVE: ret["type"] = "distributive"; break;
-    case NUMERAL_TYPE_ADVERB: ret["type"] = "adverb"; break;
-    default: throw std::logic_error("Invalid type");
+    if (fields & FORM_FIELD_VOICE) {
+        serialize_field(ret, "voice", get_name(voice_names, form.voice, "Invalid voice"));
     }
-
-    return ret;
+    ret.push_back('}');
 }
@@ -1,29 +1,13 @@
 #include "words.hpp"
+#include <iterator>
+#include <stddef.h>
 #include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
 
-std::string WordForm::tokenize() const {
-    std::string ret;
-
-    switch (part_of_speech) {
-    case PART_OF_SPEECH_NOUN: ret = "<F:N>"; break;
-    case PART_OF_SPEECH_VERB: ret = "<F:V>"; break;
-    case PART_OF_SPEECH_PARTICIPLE: ret = "<F:PAR>"; break;
-    case PART_OF_SPEECH_SUPINE: ret = "<F:S>"; break;
-    case PART_OF_SPEECH_ADJECTIVE: ret = "<F:ADJ>"; break;
-    case PART_OF_SPEECH_ADVERB: ret = "<F:ADV>"; break;
-    case PART_OF_SPEECH_PRONOUN: ret = "<F:PRON>"; break;
-    case PART_OF_SPEECH_CONJUNCTION: ret = "<F:C>"; break;
-    case PART_OF_SPEECH_PREPOSITION: ret = "<F:PREP>"; break;
-    case PART_OF_SPEECH_INTERJECTION: ret = "<F:I>"; break;
-    case PART_OF_SPEECH_NUMERAL: ret = "<F:NUM>"; break;
-    }
-
-    return ret;
-}
-
-std::string Noun::tokenize() const {
-    std::string ret = WordForm::tokenize();
-
+void tokenize_casus(std::string& ret, Casus casus) {
     switch (casus) {
     case CASUS_NOMINATIVE: ret += "<C:N>"; break;
     case CASUS_GENITIVE: ret += "<C:G>"; break;
@@ -34,13 +18,17 @@ std::string Noun::tokenize() const {
     case CASUS_LOCATIVE: ret += "<C:L>"; break;
     default: throw std::logic_error("Invalid case");
     }
+}
 
+void tokenize_plural(std::string& ret, bool plural) {
     if (plural) {
         ret += "<P:T>";
     } else {
         ret += "<P:F>";
     }
+}
 
+void tokenize_gender(std::string& ret, Gender gender) {
     switch (gender) {
     case GENDER_MASCULINE: ret += "<G:M>"; break;
     case GENDER_FEMININE: ret += "<G:F>"; break;
@@ -48,13 +36,9 @@ std::string Noun::tokenize() const {
     case GENDER_COMMON: ret += "<G:C>"; break;
     default: throw std::logic_error("Invalid gender");
     }
-
-    return ret;
 }
 
-std::string Verb::tokenize() const {
-    std::string ret = WordForm::tokenize();
-
+void tokenize_tense(std::string& ret, Tense tense) {
     switch (tense) {
     case TENSE_PRESENT: ret += "<T:PRES>"; break;
     case TENSE_IMPERFECT: ret += "<T:I>"; break;
@@ -64,13 +48,17 @@ std::string Verb::tokenize() const {
     case TENSE_FUTURE_PERFECT: ret += "<T:FPERF>"; break;
     default: throw std::logic_error("Invalid tense");
     }
+}
 
+void tokenize_voice(std::string& ret, Voice voice) {
     switch (voice) {
     case VOICE_ACTIVE: ret += "<V:A>"; break;
     case VOICE_PASSIVE: ret += "<V:P>"; break;
     default: throw std::logic_error("Invalid voice");
     }
+}
 
+void tokenize_mood(std::string& ret, Mood mood) {
     switch (mood) {
     case MOOD_INDICATIVE: ret += "<M:IND>"; break;
     case MOOD_SUBJUNCTIVE: ret += "<M:S>"; break;
@@ -78,149 +66,210 @@ std::string Verb::tokenize() const {
     case MOOD_INFINITIVE: ret += "<M:INF>"; break;
     default: throw std::logic_error("Invalid mood");
     }
-
-    ret += "<PPL:" + std::to_string(person + 1) + '>';
-
-    if (plural) {
-        ret += "<P:T>";
-    } else {
-        ret += "<P:F>";
-    }
-
-    return ret;
-}
-
-std::string Participle::tokenize() const {
-    std::string ret = WordForm::tokenize();
-
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret += "<C:N>"; break;
-    case CASUS_GENITIVE: ret += "<C:G>"; break;
-    case CASUS_DATIVE: ret += "<C:D>"; break;
-    case CASUS_ACCUSATIVE: ret += "<C:ACC>"; break;
-    case CASUS_ABLATIVE: ret += "<C:ABL>"; break;
-    case CASUS_VOCATIVE: ret += "<C:V>"; break;
-    case CASUS_LOCATIVE: ret += "<C:L>"; break;
-    default: throw std::logic_error("Invalid case");
-    }
-
-    if (plural) {
-        ret += "<P:T>";
-    } else {
-        ret += "<P:F>";
-    }
-
-    switch (gender) {
-    case GENDER_MASCULINE: ret += "<G:M>"; break;
-    case GENDER_FEMININE: ret += "<G:F>"; break;
-    case GENDER_NEUTER: ret += "<G:N>"; break;
-    case GENDER_COMMON: ret += "<G:C>"; break;
-    default: throw std::logic_error("Invalid gender");
-    }
-
-    switch (tense) {
-    case TENSE_PRESENT: ret += "<T:PRES>"; break;
-    case TENSE_IMPERFECT: ret += "<T:I>"; break;
-    case TENSE_PERFECT: ret += "<T:PERF>"; break;
-    case TENSE_PLUPERFECT: ret += "<T:PLUP>"; break;
-    case TENSE_FUTURE: ret += "<T:F>"; break;
-    case TENSE_FUTURE_PERFECT: ret += "<T:FPERF>"; break;
-    default: throw std::logic_error("Invalid tense");
-    }
-
-    switch (voice) {
-    case VOICE_ACTIVE: ret += "<V:A>"; break;
-    case VOICE_PASSIVE: ret += "<V:P>"; break;
-    default: throw std::logic_error("Invalid voice");
-    }
-
-    return ret;
 }
 
-std::string Supine::tokenize() const {
-    std::string ret = WordForm::tokenize();
-
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret += "<C:N>"; break;
-    case CASUS_GENITIVE: ret += "<C:G>"; break;
-    case CASUS_DATIVE: ret += "<C:D>"; break;
-    case CASUS_ACCUSATIVE: ret += "<C:ACC>"; break;
-    case CASUS_ABLATIVE: ret += "<C:ABL>"; break;
-    case CASUS_VOCATIVE: ret += "<C:V>"; break;
-    case CASUS_LOCATIVE: ret += "<C:L>"; break;
-    default: throw std::logic_error("Invalid case");
-    }
-
-    if (plural) {
-        ret += "<P:T>";
-    } else {
-        ret += "<P:F>";
-    }
-
-    switch (gender) {
-    case GENDER_MASCULINE: ret += "<G:M>"; break;
-    case GENDER_FEMININE: ret += "<G:F>"; break;
-    case GENDER_NEUTER: ret += "<G:N>"; break;
-    case GENDER_COMMON: ret += "<G:C>"; break;
-    default: throw std::logic_error("Invalid gender");
-    }
-
-    return ret;
-}
-
-std::string Adjective::tokenize() const {
-    std::string ret = Noun::tokenize();
-
+void tokenize_degree(std::string& ret, Degree degree) {
     switch (degree) {
     case DEGREE_POSITIVE: ret += "<D:P>"; break;
     case DEGREE_COMPARATIVE: ret += "<D:C>"; break;
     case DEGREE_SUPERLATIVE: ret += "<D:S>"; break;
     default: throw std::logic_error("Invalid degree");
     }
+}
 
-    return ret;
+void tokenize_numeral_type(std::string& ret, NumeralType numeral_type) {
+    switch (numeral_type) {
+    case NUMERAL_TYPE_CARDINAL: ret += "<N:C>"; break;
+    case NUMERAL_TYPE_ORDINAL: ret += "<N:O>"; break;
+    case NUMERAL_TYPE_DISTRIBUTIVE: ret += "<N:D>"; break;
+    case NUMERAL_TYPE_ADVERB: ret += "<N:A>"; break;
+    default: throw std::logic_error("Invalid numeral type");
+    }
 }
 
-std::string Adverb::tokenize() const {
-    std::string ret = WordForm::tokenize();
+void build_tag(std::string& ret, const WordForm& form) {
+    switch (form.part_of_speech) {
+    case PART_OF_SPEECH_NOUN: ret = "<F:N>"; break;
+    case PART_OF_SPEECH_VERB: ret = "<F:V>"; break;
+    case PART_OF_SPEECH_PARTICIPLE: ret = "<F:PAR>"; break;
+    case PART_OF_SPEECH_SUPINE: ret = "<F:S>"; break;
+    case PART_OF_SPEECH_ADJECTIVE: ret = "<F:ADJ>"; break;
+    case PART_OF_SPEECH_ADVERB: ret = "<F:ADV>"; break;
+    case PART_OF_SPEECH_PRONOUN: ret = "<F:PRON>"; break;
+    case PART_OF_SPEECH_CONJUNCTION: ret = "<F:C>"; break;
+    case PART_OF_SPEECH_PREPOSITION: ret = "<F:PREP>"; break;
+    case PART_OF_SPEECH_INTERJECTION: ret = "<F:I>"; break;
+    case PART_OF_SPEECH_NUMERAL: ret = "<F:NUM>"; break;
+    }
 
-    switch (degree) {
-    case DEGREE_POSITIVE: ret += "<D:P>"; break;
-    case DEGREE_COMPARATIVE: ret += "<D:C>"; break;
-    case DEGREE_SUPERLATIVE: ret += "<D:S>"; break;
-    default: throw std::logic_error("Invalid degree");
+    switch (form.part_of_speech) {
+    case PART_OF_SPEECH_NOUN:
+    case PART_OF_SPEECH_PRONOUN:
+    case PART_OF_SPEECH_SUPINE:
+        tokenize_casus(ret, form.casus);
+        tokenize_plural(ret, form.plural);
+        tokenize_gender(ret, form.gender);
+        break;
+
+    case PART_OF_SPEECH_VERB:
+        tokenize_tense(ret, form.tense);
+        tokenize_voice(ret, form.voice);
+        tokenize_mood(ret, form.mood);
+        ret += "<PPL:" + std::to_string(form.person + 1) + '>';
+        tokenize_plural(ret, form.plural);
+        break;
+
+    case PART_OF_SPEECH_PARTICIPLE:
+        tokenize_casus(ret, form.casus);
+        tokenize_plural(ret, form.plural);
+        tokenize_gender(ret, form.gender);
+        tokenize_tense(ret, form.tense);
+        tokenize_voice(ret, form.voice);
+        break;
+
+    case PART_OF_SPEECH_ADJECTIVE:
+        tokenize_casus(ret, form.casus);
+        tokenize_plural(ret, form.plural);
+        tokenize_gender(ret, form.gender);
+        tokenize_degree(ret, form.degree);
+        break;
+
+    case PART_OF_SPEECH_ADVERB:
+        tokenize_degree(ret, form.degree);
+        break;
+
+    case PART_OF_SPEECH_PREPOSITION:
+        tokenize_casus(ret, form.casus);
+        break;
+
+    case PART_OF_SPEECH_NUMERAL:
+        tokenize_casus(ret, form.casus);
+        tokenize_plural(ret, form.plural);
+        tokenize_gender(ret, form.gender);
+        tokenize_numeral_type(ret, form.numeral_type);
+        break;
+
+    default:
+        break;
     }
+}
 
+// The features that go into each part of speech's tag
+enum TagFeature {
+    TAG_FEATURE_CASUS = 1 << 0,
+    TAG_FEATURE_GENDER = 1 << 1,
+    TAG_FEATURE_DEGREE = 1 << 2,
+    TAG_FEATURE_TENSE = 1 << 3,
+    TAG_FEATURE_VOICE = 1 << 4,
+    TAG_FEATURE_MOOD = 1 << 5,
+    TAG_FEATURE_NUMERAL_TYPE = 1 << 6,
+    TAG_FEATURE_PERSON = 1 << 7,
+    TAG_FEATURE_PLURAL = 1 << 8,
+};
+
+constexpr unsigned tag_features[] = {
+    TAG_FEATURE_CASUS | TAG_FEATURE_GENDER | TAG_FEATURE_PLURAL,                                            // Noun
+    TAG_FEATURE_TENSE | TAG_FEATURE_VOICE | TAG_FEATURE_MOOD | TAG_FEATURE_PERSON | TAG_FEATURE_PLURAL,     // Verb
+    TAG_FEATURE_CASUS | TAG_FEATURE_GENDER | TAG_FEATURE_TENSE | TAG_FEATURE_VOICE | TAG_FEATURE_PLURAL,    // Participle
+    TAG_FEATURE_CASUS | TAG_FEATURE_GENDER | TAG_FEATURE_PLURAL,                                            // Supine
+    TAG_FEATURE_CASUS | TAG_FEATURE_GENDER | TAG_FEATURE_DEGREE | TAG_FEATURE_PLURAL,                       // Adjective
+    TAG_FEATURE_DEGREE,                                                                                     // Adverb
+    TAG_FEATURE_CASUS | TAG_FEATURE_GENDER | TAG_FEATURE_PLURAL,                                            // Pronoun
+    0,                                                                                                      // Conjunction
+    TAG_FEATURE_CASUS,                                                                                      // Preposition
+    0,                                                                                                      // Interjection
+    TAG_FEATURE_CASUS | TAG_FEATURE_GENDER | TAG_FEATURE_NUMERAL_TYPE | TAG_FEATURE_PLURAL,                 // Numeral
+};
+
+// The width of each feature's bitfield in WordForm, in the order of TagFeature
+constexpr unsigned tag_feature_bits[] = {3, 3, 2, 3, 2, 3, 3, 2, 1};
+
+static_assert(std::size(tag_features) == PART_OF_SPEECH_NUMERAL + 1, "Every part of speech must have tag features");
+
+// Packs the features that go into a form's tag into a key, which is unique among forms of the same part of speech
+unsigned get_tag_key(const WordForm& form) {
+    unsigned features = tag_features[form.part_of_speech];
+    unsigned feature_values[] = {form.casus, form.gender, form.degree, form.tense, form.voice, form.mood, form.numeral_type, form.person, form.plural};
+
+    unsigned ret = 0;
+    for (size_t i = 0; i < std::size(feature_values); ++i) {
+        if (features & (1 << i)) {
+            ret = ret << tag_feature_bits[i] | feature_values[i];
+        }
+    }
     return ret;
 }
 
-std::string Preposition::tokenize() const {
-    std::string ret = WordForm::tokenize();
-
-    switch (casus) {
-    case CASUS_NOMINATIVE: ret += "<C:N>"; break;
-    case CASUS_GENITIVE: ret += "<C:G>"; break;
-    case CASUS_DATIVE: ret += "<C:D>"; break;
-    case CASUS_ACCUSATIVE: ret += "<C:ACC>"; break;
-    case CASUS_ABLATIVE: ret += "<C:ABL>"; break;
-    case CASUS_VOCATIVE: ret += "<C:V>"; break;
-    case CASUS_LOCATIVE: ret += "<C:L>"; break;
-    default: throw std::logic_error("Invalid case");
+// The inverse of get_tag_key
+WordForm make_tag_form(PartOfSpeech part_of_speech, unsigned key) {
+    unsigned features = tag_features[part_of_speech];
+    unsigned feature_values[std::size(tag_feature_bits)] = {};
+    for (size_t i = std::size(feature_values); i-- > 0;) {
+        if (features & (1 << i)) {
+            feature_values[i] = key & ((1 << tag_feature_bits[i]) - 1);
+            key >>= tag_feature_bits[i];
+        }
     }
 
+    WordForm ret = WordForm::make(part_of_speech);
+    ret.casus = (Casus) feature_values[0];
+    ret.gender = (Gender) feature_values[1];
+    ret.degree = (Degree) feature_values[2];
+    ret.tense = (Tense) feature_values[3];
+    ret.voice = (Voice) feature_values[4];
+    ret.mood = (Mood) feature_values[5];
+    ret.numeral_type = (NumeralType) feature_values[6];
+    ret.person = feature_values[7];
+    ret.plural = feature_values[8];
     return ret;
 }
 
-std::string Numeral::tokenize() const {
-    std::string ret = Noun::tokenize();
-
-    switch (type) {
-    case NUMERAL_TYPE_CARDINAL: ret += "<N:C>"; break;
-    case NUMERAL_TYPE_ORDINAL: ret += "<N:O>"; break;
-    case NUMERAL_TYPE_DISTRIBUTIVE: ret += "<N:D>"; break;
-    case NUMERAL_TYPE_ADVERB: ret += "<N:A>"; break;
-    default: throw std::logic_error("Invalid numeral type");
+// Every form's tag, built once for every key of every part of speech
+class TagTable {
+protected:
+    std::string tags;                               // Every tag back to back
+    std::vector<uint32_t> offsets;                  // Where each key's tag starts in tags, followed by the end of the last one
+    uint32_t key_offsets[PART_OF_SPEECH_NUMERAL + 1]; // Where each part of speech's keys start in offsets
+
+public:
+    TagTable() {
+        std::string tag;
+        for (int part_of_speech = 0; part_of_speech <= PART_OF_SPEECH_NUMERAL; ++part_of_speech) {
+            unsigned key_bits = 0;
+            for (size_t i = 0; i < std::size(tag_feature_bits); ++i) {
+                if (tag_features[part_of_speech] & (1 << i)) {
+                    key_bits += tag_feature_bits[i];
+                }
+            }
+
+            key_offsets[part_of_speech] = offsets.size();
+            for (unsigned key = 0; key < 1u << key_bits; ++key) {
+                offsets.push_back(tags.size());
+                // Keys with invalid features get an empty tag, so that tokenize can rebuild them to throw the right error
+                try {
+                    build_tag(tag, make_tag_form((PartOfSpeech) part_of_speech, key));
+                    tags += tag;
+                } catch (const std::logic_error& e) {}
+            }
+        }
+        offsets.push_back(tags.size());
     }
 
+    std::string_view get(const WordForm& form) const {
+        if (form.part_of_speech > PART_OF_SPEECH_NUMERAL) {
+            return {};
+        }
+        size_t i = key_offsets[form.part_of_speech] + get_tag_key(form);
+        return std::string_view(tags).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+std::string_view tokenize(const WordForm& form) {
+    static const TagTable tag_table;
+    std::string_view ret = tag_table.get(form);
+    if (ret.empty()) {
+        std::string tag;
+        build_tag(tag, form); // Throws
+    }
     return ret;
 }
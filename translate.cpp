@@ -12,8 +12,6 @@
 
 using nlohmann::json;
 
-thread_local std::unordered_map<std::string, std::pair<std::string, std::string>> irregular_verbs;
-
 bool is_vowel(char c, bool include_y = false) {
     c = tolower(c);
     return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' || (include_y && c == 'y');
@@ -30,20 +28,179 @@ bool is_short(std::string_view word) {
     }) == word.end() - 2;
 }
 
-void init_irregular_verbs() {
-    if (irregular_verbs.empty()) {
-        std::ifstream irregular_verbs_file("irregular_verbs.json");
-        if (irregular_verbs_file.is_open()) {
-            json irregular_verbs_json = json::parse(irregular_verbs_file);
-            irregular_verbs.reserve(irregular_verbs_json.size());
-            for (const auto& verb : irregular_verbs_json.items()) {
-                irregular_verbs[verb.key()] = std::make_pair<std::string, std::string>(verb.value()["past"], verb.value()["past_participle"]);
-            }
+typedef std::unordered_map<std::string, std::pair<std::string, std::string>> IrregularVerbs; // Past and past participle by base
+
+IrregularVerbs load_irregular_verbs() {
+    IrregularVerbs ret;
+    std::ifstream irregular_verbs_file("irregular_verbs.json");
+    if (irregular_verbs_file.is_open()) {
+        json irregular_verbs_json = json::parse(irregular_verbs_file);
+        ret.reserve(irregular_verbs_json.size());
+        for (const auto& verb : irregular_verbs_json.items()) {
+            ret[verb.key()] = std::make_pair<std::string, std::string>(verb.value()["past"], verb.value()["past_participle"]);
+        }
+    }
+    return ret;
+}
+
+// Loaded by whichever thread gets here first, then shared read-only by all of them
+const IrregularVerbs& get_irregular_verbs() {
+    static const IrregularVerbs irregular_verbs = load_irregular_verbs();
+    return irregular_verbs;
+}
+
+bool init_irregular_verbs() {
+    return !get_irregular_verbs().empty();
+}
+
+void add_s(std::string& ret, bool noun) {
+    if (ret.empty()) {
+        return;
+    }
+
+    switch (ret.back()) {
+    case 'y':
+        if (is_short(ret)) {
+            break;
+        }
+        ret.back() = 'i';
+        goto add_e;
+
+    case 'h':
+        if (ret.size() >= 2 &&
+            (ret[ret.size() - 2] == 'p' ||
+                (noun && (ret[ret.size() - 2] == 't' || ret[ret.size() - 2] == 'g')))) {
+            break;
+        }
+    case 'i':
+    case 'o':
+    case 's':
+    case 'x':
+    add_e:
+        ret.push_back('e');
+        break;
+    }
+    ret.push_back('s');
+}
+
+std::string make_present_participle(const std::string& english_base) {
+    std::string ret = english_base;
+    if (ret.empty()) {
+        return ret;
+    }
+
+    if (ret.back() == 'e') {
+        ret.back() = 'i';
+        ret += "ng";
+    } else {
+        if (is_short(english_base) &&
+            is_consonant(english_base.back(), false) &&
+            tolower(english_base.back()) != 'w') {
+            ret.push_back(ret.back());
+        }
+        ret += "ing";
+    }
+    return ret;
+}
+
+std::string make_regular_past(const std::string& english_base) {
+    std::string ret = english_base;
+    if (ret.empty()) {
+        return ret;
+    }
+
+    if (ret.back() == 'e') {
+        ret.push_back('d');
+        return ret;
+    } else if (ret.back() == 'y') {
+        ret.back() = 'i';
+    } else if (is_short(english_base) &&
+               is_consonant(english_base.back(), false) &&
+               tolower(english_base.back()) != 'w') {
+        ret.push_back(ret.back());
+    }
+    ret += "ed";
+    return ret;
+}
+
+// Every inflection of an English base that takes spelling rules or irregular verbs to work out
+struct EnglishInflections {
+    std::string plural;
+    std::string third_person; // As in "it loves"
+    std::string present_participle;
+    std::string past;
+    std::string past_participle;
+    std::string comparative;
+    std::string adverb_comparative;
+    std::string adverb_superlative;
+};
+
+// Inflections are worked out once per base, and then only have prefixes added to them
+const EnglishInflections& get_english_inflections(const std::string& english_base) {
+    static constexpr size_t max_bases = 16384;
+    thread_local std::unordered_map<std::string, EnglishInflections> english_inflections;
+
+    decltype(english_inflections)::const_iterator inflections_it;
+    if ((inflections_it = english_inflections.find(english_base)) != english_inflections.end()) {
+        return inflections_it->second;
+    }
+    if (english_inflections.size() >= max_bases) {
+        english_inflections.clear();
+    }
+
+    EnglishInflections ret;
+    ret.plural = english_base;
+    add_s(ret.plural, true);
+    ret.third_person = english_base;
+    add_s(ret.third_person, false);
+    ret.present_participle = make_present_participle(english_base);
+
+    const IrregularVerbs& irregular_verbs = get_irregular_verbs();
+    IrregularVerbs::const_iterator irregular_verb_it;
+    if ((irregular_verb_it = irregular_verbs.find(english_base)) != irregular_verbs.end()) {
+        ret.past = irregular_verb_it->second.first;
+        ret.past_participle = irregular_verb_it->second.second;
+    } else {
+        ret.past = ret.past_participle = make_regular_past(english_base);
+    }
+
+    if (!english_base.empty()) {
+        ret.comparative = english_base;
+        ret.comparative += english_base.back() == 'e' ? "r" : "er";
+    }
+
+    std::string adverb_base = english_base;
+    if (pw::string::ends_with(adverb_base, "ly")) {
+        adverb_base.erase(adverb_base.size() - 2);
+    }
+    ret.adverb_superlative = "most-" + adverb_base;
+    if (!adverb_base.empty()) {
+        ret.adverb_comparative = adverb_base;
+        if (adverb_base.back() == 'e') {
+            ret.adverb_comparative.push_back('r');
+        } else if (adverb_base.back() == 'i') {
+            ret.adverb_comparative.back() = 'e';
+            ret.adverb_comparative.push_back('r');
+        } else {
+            ret.adverb_comparative += "er";
         }
     }
+
+    return english_inflections.emplace(english_base, std::move(ret)).first->second;
+}
+
+std::string add_prefix(const char* prefix, const std::string& word) {
+    std::string ret;
+    if (prefix) {
+        size_t prefix_size = strlen(prefix);
+        ret.reserve(prefix_size + word.size());
+        ret.assign(prefix, prefix_size);
+    }
+    ret += word;
+    return ret;
 }
 
-std::string Noun::english_equivalent(const std::string& english_base) const {
+std::string noun_english_equivalent(const WordForm& form, const std::string& english_base) {
     static constexpr const char* prefixes[7] = {
         nullptr,
         "of ",
@@ -54,45 +211,10 @@ std::string Noun::english_equivalent(const std::string& english_base) const {
         "at ",
     };
 
-    std::string ret;
-    if (prefixes[casus]) {
-        ret = prefixes[casus] + english_base; // Add prefix
-    } else {
-        ret = english_base;
-    }
-
-    // Add suffix
-    if (plural) {
-        switch (ret.back()) {
-        case 'y':
-            if (is_short(english_base)) {
-                break;
-            }
-            ret.back() = 'i';
-            goto add_e;
-
-        case 'h':
-            if (english_base.size() >= 2 &&
-                (english_base[english_base.size() - 2] == 't' ||
-                    english_base[english_base.size() - 2] == 'p' ||
-                    english_base[english_base.size() - 2] == 'g')) {
-                break;
-            }
-        case 'i':
-        case 'o':
-        case 's':
-        case 'x':
-        add_e:
-            ret.push_back('e');
-            break;
-        }
-        ret.push_back('s');
-    }
-
-    return ret;
+    return add_prefix(prefixes[form.casus], form.plural ? get_english_inflections(english_base).plural : english_base);
 }
 
-std::string Verb::english_equivalent(const std::string& english_base) const {
+std::string verb_english_equivalent(const WordForm& form, const std::string& english_base) {
     static constexpr const char* be[4][6][3][2] = {
         // Indicative mood
         {
@@ -345,185 +467,62 @@ std::string Verb::english_equivalent(const std::string& english_base) const {
         },
     };
 
-    if (conjugation == 5 && english_base == "be") {
-        if (be[mood][tense][person][plural]) {
-            return be[mood][tense][person][plural];
+    if (form.get_conjugation() == 5 && english_base == "be") {
+        if (be[form.mood][form.tense][form.person][form.plural]) {
+            return be[form.mood][form.tense][form.person][form.plural];
         }
     }
 
-    std::string ret;
-    if (prefixes[voice][mood][tense][person][plural]) {
-        ret = prefixes[voice][mood][tense][person][plural]; // Add prefix
-    }
-
-    // Add suffix
-    init_irregular_verbs();
-    switch (voice) {
+    const EnglishInflections& inflections = get_english_inflections(english_base);
+    const std::string* inflection = &english_base;
+    switch (form.voice) {
     case VOICE_ACTIVE:
-        switch (mood) {
+        switch (form.mood) {
         case MOOD_INDICATIVE:
-            switch (tense) {
+            switch (form.tense) {
             case TENSE_PRESENT:
-                ret += english_base;
-                if (person == 2 && !plural) {
-                    switch (ret.back()) {
-                    case 'y':
-                        if (is_short(english_base)) {
-                            break;
-                        }
-                        ret.back() = 'i';
-                        goto add_e;
-
-                    case 'h':
-                        if (english_base.size() >= 2 && english_base[english_base.size() - 2] == 'p') {
-                            break;
-                        }
-                    case 'i':
-                    case 'o':
-                    case 's':
-                    case 'x':
-                    add_e:
-                        ret.push_back('e');
-                        break;
-                    }
-                    ret.push_back('s');
+                if (form.person == 2 && !form.plural) {
+                    inflection = &inflections.third_person;
                 }
                 break;
 
-            case TENSE_IMPERFECT:
-                ret += english_base;
-                if (ret.back() == 'e') {
-                    ret.back() = 'i';
-                    ret += "ng";
-                } else {
-                    if (is_short(english_base) &&
-                        is_consonant(english_base.back(), false) &&
-                        tolower(english_base.back()) != 'w') {
-                        ret.push_back(ret.back());
-                    }
-                    ret += "ing";
-                }
-                break;
-
-            case TENSE_PERFECT:
+            case TENSE_IMPERFECT: inflection = &inflections.present_participle; break;
+            case TENSE_PERFECT: inflection = &inflections.past; break;
             case TENSE_PLUPERFECT:
-            case TENSE_FUTURE_PERFECT: {
-                decltype(irregular_verbs)::const_iterator irregular_verb_it;
-                if ((irregular_verb_it = irregular_verbs.find(english_base)) != irregular_verbs.end()) {
-                    ret += tense == TENSE_PERFECT ? irregular_verb_it->second.first : irregular_verb_it->second.second;
-                } else {
-                    ret += english_base;
-                    if (ret.back() == 'e') {
-                        ret.push_back('d');
-                        break;
-                    } else if (ret.back() == 'y') {
-                        ret.back() = 'i';
-                    } else if (is_short(english_base) &&
-                               is_consonant(english_base.back(), false) &&
-                               tolower(english_base.back()) != 'w') {
-                        ret.push_back(ret.back());
-                    }
-                    ret += "ed";
-                }
-                break;
-            }
-
-            default:
-                ret += english_base;
-                break;
+            case TENSE_FUTURE_PERFECT: inflection = &inflections.past_participle; break;
+            default: break;
             }
             break;
 
         case MOOD_SUBJUNCTIVE:
-            switch (tense) {
-            case TENSE_PERFECT:
-            case TENSE_PLUPERFECT: {
-                decltype(irregular_verbs)::const_iterator irregular_verb_it;
-                if ((irregular_verb_it = irregular_verbs.find(english_base)) != irregular_verbs.end()) {
-                    ret += irregular_verb_it->second.second;
-                } else {
-                    ret += english_base;
-                    if (ret.back() == 'e') {
-                        ret.push_back('d');
-                        break;
-                    } else if (ret.back() == 'y') {
-                        ret.back() = 'i';
-                    } else if (is_short(english_base) &&
-                               is_consonant(english_base.back(), false) &&
-                               tolower(english_base.back()) != 'w') {
-                        ret.push_back(ret.back());
-                    }
-                    ret += "ed";
-                }
-                break;
-            }
-
-            default:
-                ret += english_base;
-                break;
+            if (form.tense == TENSE_PERFECT || form.tense == TENSE_PLUPERFECT) {
+                inflection = &inflections.past_participle;
             }
             break;
 
         case MOOD_INFINITIVE:
-            if (tense == TENSE_PERFECT) {
-                decltype(irregular_verbs)::const_iterator irregular_verb_it;
-                if ((irregular_verb_it = irregular_verbs.find(english_base)) != irregular_verbs.end()) {
-                    ret += irregular_verb_it->second.second;
-                } else {
-                    ret += english_base;
-                    if (ret.back() == 'e') {
-                        ret.push_back('d');
-                        break;
-                    } else if (ret.back() == 'y') {
-                        ret.back() = 'i';
-                    } else if (is_short(english_base) &&
-                               is_consonant(english_base.back(), false) &&
-                               tolower(english_base.back()) != 'w') {
-                        ret.push_back(ret.back());
-                    }
-                    ret += "ed";
-                }
-                break;
-            } else {
-                ret += english_base;
+            if (form.tense == TENSE_PERFECT) {
+                inflection = &inflections.past_participle;
             }
             break;
 
         default:
-            ret += english_base;
             break;
         }
         break;
 
-    case VOICE_PASSIVE: {
-        decltype(irregular_verbs)::const_iterator irregular_verb_it;
-        if ((irregular_verb_it = irregular_verbs.find(english_base)) != irregular_verbs.end()) {
-            ret += irregular_verb_it->second.second;
-        } else {
-            ret += english_base;
-            if (ret.back() == 'e') {
-                ret.push_back('d');
-                break;
-            } else if (ret.back() == 'y') {
-                ret.back() = 'i';
-            } else if (is_short(english_base) &&
-                       is_consonant(english_base.back(), false) &&
-                       tolower(english_base.back()) != 'w') {
-                ret.push_back(ret.back());
-            }
-            ret += "ed";
-        }
+    case VOICE_PASSIVE:
+        inflection = &inflections.past_participle;
         break;
-    }
 
     default:
         throw std::logic_error("Invalid gender");
     }
 
-    return ret;
+    return add_prefix(prefixes[form.voice][form.mood][form.tense][form.person][form.plural], *inflection);
 }
 
-std::string Participle::english_equivalent(const std::string& english_base) const {
+std::string participle_english_equivalent(const WordForm& form, const std::string& english_base) {
     static constexpr const char* prefixes[2][6] = {
         // Active voice
         {
@@ -543,75 +542,26 @@ std::string Participle::english_equivalent(const std::string& english_base) cons
         },
     };
 
-    std::string ret;
-    if (prefixes[voice][tense]) {
-        ret = prefixes[voice][tense]; // Add prefix
+    const EnglishInflections& inflections = get_english_inflections(english_base);
+    switch (form.voice) {
+    case VOICE_ACTIVE: return add_prefix(prefixes[form.voice][form.tense], form.tense == TENSE_PRESENT ? inflections.present_participle : english_base);
+    case VOICE_PASSIVE: return add_prefix(prefixes[form.voice][form.tense], inflections.past_participle);
+    default: throw std::logic_error("Invalid voice");
     }
-
-    // Add suffix
-    init_irregular_verbs();
-    switch (voice) {
-    case VOICE_ACTIVE:
-        ret += english_base;
-        if (tense == TENSE_PRESENT) {
-            if (ret.back() == 'e') {
-                ret.back() = 'i';
-                ret += "ng";
-            } else {
-                if (is_short(english_base) &&
-                    is_consonant(english_base.back(), false) &&
-                    tolower(english_base.back()) != 'w') {
-                    ret.push_back(ret.back());
-                }
-                ret += "ing";
-            }
-        }
-        break;
-
-    case VOICE_PASSIVE: {
-        decltype(irregular_verbs)::const_iterator irregular_verb_it;
-        if ((irregular_verb_it = irregular_verbs.find(english_base)) != irregular_verbs.end()) {
-            ret += irregular_verb_it->second.second;
-        } else {
-            ret += english_base;
-            if (ret.back() == 'e') {
-                ret.push_back('d');
-                break;
-            } else if (ret.back() == 'y') {
-                ret.back() = 'i';
-            } else if (is_short(english_base) &&
-                       is_consonant(english_base.back(), false) &&
-                       tolower(english_base.back()) != 'w') {
-                ret.push_back(ret.back());
-            }
-            ret += "ed";
-        }
-        break;
-    }
-
-    default:
-        throw std::logic_error("Invalid voice");
-    }
-
-    return ret;
 }
 
-std::string Supine::english_equivalent(const std::string& english_base) const {
-    switch (casus) {
+std::string supine_english_equivalent(const WordForm& form, const std::string& english_base) {
+    switch (form.casus) {
     case CASUS_ACCUSATIVE: return "to " + english_base;
     case CASUS_ABLATIVE: return "be " + english_base;
     default: throw std::logic_error("Invalid case");
     }
 }
 
-std::string Adjective::english_equivalent(const std::string& english_base) const {
-    switch (degree) {
+std::string adjective_english_equivalent(const WordForm& form, const std::string& english_base) {
+    switch (form.degree) {
     case DEGREE_COMPARATIVE:
-        if (english_base.back() == 'e') {
-            return english_base + 'r';
-        } else {
-            return english_base + "er";
-        }
+        return get_english_inflections(english_base).comparative;
 
     case DEGREE_SUPERLATIVE:
         return "most-" + english_base;
@@ -621,40 +571,16 @@ std::string Adjective::english_equivalent(const std::string& english_base) const
     }
 }
 
-std::string Adverb::english_equivalent(const std::string& english_base) const {
-    if (degree) {
-        std::string ret = english_base;
-        if (pw::string::ends_with(english_base, "ly")) {
-            ret.erase(ret.size() - 2);
-        }
-
-        switch (degree) {
-        case DEGREE_COMPARATIVE:
-            if (ret.back() == 'e') {
-                ret.push_back('r');
-            } else if (ret.back() == 'i') {
-                ret.back() = 'e';
-                ret.push_back('r');
-            } else {
-                ret += "er";
-            }
-            break;
-
-        case DEGREE_SUPERLATIVE:
-            ret.insert(0, "most-");
-            break;
-
-        default:
-            throw std::logic_error("Invalid degree of comparison");
-        }
-
-        return ret;
+std::string adverb_english_equivalent(const WordForm& form, const std::string& english_base) {
+    switch (form.degree) {
+    case DEGREE_POSITIVE: return english_base;
+    case DEGREE_COMPARATIVE: return get_english_inflections(english_base).adverb_comparative;
+    case DEGREE_SUPERLATIVE: return get_english_inflections(english_base).adverb_superlative;
+    default: throw std::logic_error("Invalid degree of comparison");
     }
-
-    return english_base;
 }
 
-std::string Pronoun::english_equivalent(const std::string& english_base) const {
+std::string pronoun_english_equivalent(const WordForm& form, const std::string& english_base) {
     static constexpr const char* he[5][4][2] = {
         // Nominative case
         {
@@ -739,30 +665,30 @@ std::string Pronoun::english_equivalent(const std::string& english_base) const {
         "at ",
     };
 
-    switch (declension) {
+    switch (form.get_declension()) {
     case 4:
-        if (english_base == "he" && he[casus][gender][plural]) {
-            return he[casus][gender][plural];
+        if (english_base == "he" && he[form.casus][form.gender][form.plural]) {
+            return he[form.casus][form.gender][form.plural];
         }
         break;
 
     case 6:
-        if (english_base == "himself" && himself[casus][gender][plural]) {
-            return himself[casus][gender][plural];
+        if (english_base == "himself" && himself[form.casus][form.gender][form.plural]) {
+            return himself[form.casus][form.gender][form.plural];
         }
         break;
     }
 
-    if (prefixes[casus]) {
-        return prefixes[casus] + english_base; // Add prefix
+    if (prefixes[form.casus]) {
+        return prefixes[form.casus] + english_base; // Add prefix
     } else {
         return english_base;
     }
 }
 
-std::string Numeral::english_equivalent(const std::string& english_base) const {
+std::string numeral_english_equivalent(const WordForm& form, const std::string& english_base) {
     std::string ret = english_base;
-    if (type == NUMERAL_TYPE_ORDINAL) {
+    if (form.numeral_type == NUMERAL_TYPE_ORDINAL) {
         switch (ret[ret.size() - 3]) { // The english base should be at least 3 characters
         case '1':
             memcpy(&ret[ret.size() - 2], "st", 2);
@@ -779,3 +705,20 @@ std::string Numeral::english_equivalent(const std::string& english_base) const {
     }
     return ret;
 }
+
+std::string english_equivalent(const WordForm& form, const std::string& english_base) {
+    switch (form.part_of_speech) {
+    case PART_OF_SPEECH_NOUN: return noun_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_VERB: return verb_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_PARTICIPLE: return participle_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_SUPINE: return supine_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_ADJECTIVE: return adjective_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_ADVERB: return adverb_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_PRONOUN: return pronoun_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_NUMERAL: return numeral_english_equivalent(form, english_base);
+    case PART_OF_SPEECH_CONJUNCTION:
+    case PART_OF_SPEECH_PREPOSITION:
+    case PART_OF_SPEECH_INTERJECTION: return english_base;
+    default: throw std::logic_error("Invalid part of speech");
+    }
+}
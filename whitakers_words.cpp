@@ -0,0 +1,289 @@
+#include "whitakers_words.hpp"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <signal.h>
+#include <stdexcept>
+#include <string.h>
+#include <string_view>
+#include <sys/wait.h>
+#include <unistd.h>
+
+WhitakersWordsPool::WhitakersWordsPool(const std::string& start_dir, size_t process_count, const std::string& binary):
+    start_dir(start_dir),
+    binary(binary),
+    processes(std::max<size_t>(process_count, 1)) {
+    signal(SIGPIPE, SIG_IGN); // Writing to a process that just crashed must not take down the server
+
+    if (pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) == -1) {
+        throw std::runtime_error("Failed to create pipe: " + std::string(strerror(errno)));
+    }
+
+    try {
+        for (auto& process : processes) {
+            start(process);
+        }
+    } catch (const std::runtime_error& e) {
+        for (auto& process : processes) {
+            stop(process);
+        }
+        close(wake_pipe[0]);
+        close(wake_pipe[1]);
+        throw;
+    }
+
+    thread = std::thread(&WhitakersWordsPool::run, this);
+}
+
+WhitakersWordsPool::~WhitakersWordsPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake();
+    thread.join();
+
+    for (auto& process : processes) {
+        stop(process);
+    }
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+}
+
+void WhitakersWordsPool::query(const std::vector<std::string>& words, std::vector<std::string>& ret) {
+    ret.clear();
+    ret.resize(words.size());
+    if (words.empty()) {
+        return;
+    }
+
+    Batch batch = {&ret, words.size()};
+    std::unique_lock<std::mutex> lock(mutex);
+    for (size_t i = 0; i < words.size(); ++i) {
+        queue.push_back({&words[i], &batch, i});
+    }
+    wake();
+    done_cv.wait(lock, [&batch]() {
+        return !batch.remaining;
+    });
+}
+
+void WhitakersWordsPool::start(Process& process) {
+    int in_pipe[2];
+    int out_pipe[2];
+    if (pipe2(in_pipe, O_CLOEXEC) == -1) {
+        throw std::runtime_error("Failed to create pipe: " + std::string(strerror(errno)));
+    }
+    if (pipe2(out_pipe, O_CLOEXEC) == -1) {
+        int error = errno;
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        throw std::runtime_error("Failed to create pipe: " + std::string(strerror(error)));
+    }
+
+    pid_t pid;
+    if ((pid = fork()) == -1) {
+        int error = errno;
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        throw std::runtime_error("Failed to start Whitaker's Words: " + std::string(strerror(error)));
+    } else if (!pid) {
+        // Only async-signal-safe calls are allowed here, since other threads may have held locks when the process forked
+        // dup2 clears close-on-exec for the new descriptors, so only stdin and stdout are inherited
+        if (dup2(in_pipe[0], STDIN_FILENO) == -1 || dup2(out_pipe[1], STDOUT_FILENO) == -1 || chdir(start_dir.c_str()) == -1) {
+            _exit(127);
+        }
+        execl(binary.c_str(), binary.c_str(), (char*) nullptr);
+        _exit(127);
+    }
+
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    fcntl(in_pipe[1], F_SETFL, O_NONBLOCK);
+    fcntl(out_pipe[0], F_SETFL, O_NONBLOCK);
+
+    process.pid = pid;
+    process.in = in_pipe[1];
+    process.out = out_pipe[0];
+    process.ready = false;
+    process.input.clear();
+    process.output.clear();
+    process.last_activity = std::chrono::steady_clock::now();
+}
+
+void WhitakersWordsPool::stop(Process& process) {
+    if (process.pid != -1) {
+        kill(process.pid, SIGKILL);
+        waitpid(process.pid, nullptr, 0);
+        close(process.in);
+        close(process.out);
+        process.pid = -1;
+        process.in = -1;
+        process.out = -1;
+    }
+}
+
+void WhitakersWordsPool::restart(Process& process) {
+    static constexpr unsigned max_attempts = 2;
+    static constexpr std::chrono::milliseconds min_restart_delay(250);
+    static constexpr std::chrono::milliseconds max_restart_delay(60000);
+
+    stop(process);
+
+    // Retry the words the process had been given elsewhere, except for any that keep crashing it
+    for (auto& request : process.requests) {
+        if (++request.attempts < max_attempts) {
+            queue.push_back(request);
+        } else {
+            complete(request, {});
+        }
+    }
+    process.requests.clear();
+
+    // Processes that exit before they're ready (e.g. because the binary is missing) are restarted less and less often
+    if (process.ready) {
+        process.restart_delay = std::chrono::milliseconds(0);
+    } else {
+        process.restart_delay = std::clamp(process.restart_delay * 2, min_restart_delay, max_restart_delay);
+    }
+    process.restart_time = std::chrono::steady_clock::now() + process.restart_delay;
+}
+
+void WhitakersWordsPool::dispatch() {
+    while (!queue.empty()) {
+        Process* least_busy_process = nullptr;
+        for (auto& process : processes) {
+            if (process.pid != -1 && (!least_busy_process || process.requests.size() < least_busy_process->requests.size())) {
+                least_busy_process = &process;
+            }
+        }
+        if (!least_busy_process) {
+            return;
+        }
+
+        if (least_busy_process->requests.empty()) {
+            least_busy_process->last_activity = std::chrono::steady_clock::now();
+        }
+        least_busy_process->input += *queue.front().word;
+        least_busy_process->input.push_back('\n');
+        least_busy_process->requests.push_back(queue.front());
+        queue.pop_front();
+    }
+}
+
+bool WhitakersWordsPool::read_output(Process& process) {
+    static constexpr std::string_view more_prompt = "MORE - hit RETURN/ENTER to continue";
+
+    char buf[4096];
+    ssize_t n;
+    if ((n = read(process.out, buf, sizeof buf)) <= 0) {
+        return n == -1 && (errno == EAGAIN || errno == EINTR);
+    }
+    process.output.append(buf, n);
+    process.last_activity = std::chrono::steady_clock::now();
+
+    // PAUSE_IN_SCREEN_OUTPUT is turned off, but a stale settings file must not leave the process waiting forever
+    for (size_t pos; (pos = process.output.find(more_prompt)) != std::string::npos;) {
+        process.output.erase(pos, more_prompt.size());
+        process.input.push_back('\n');
+    }
+
+    // Every answer is followed by a "=>" prompt, as is the startup banner
+    for (size_t pos; (pos = process.output.find('>')) != std::string::npos;) {
+        if (!process.ready) {
+            process.ready = true;
+        } else if (!process.requests.empty()) {
+            size_t size = pos && process.output[pos - 1] == '=' ? pos - 1 : pos;
+            complete(process.requests.front(), process.output.substr(0, size));
+            process.requests.pop_front();
+        }
+        process.output.erase(0, pos + 1);
+    }
+    return true;
+}
+
+void WhitakersWordsPool::complete(Request& request, std::string output) {
+    (*request.batch->outputs)[request.index] = std::move(output);
+    if (!--request.batch->remaining) {
+        done_cv.notify_all();
+    }
+}
+
+void WhitakersWordsPool::wake() {
+    char c = 0;
+    write(wake_pipe[1], &c, 1); // If the pipe is full, the event loop is already due to wake up
+}
+
+void WhitakersWordsPool::run() {
+    static constexpr int poll_interval = 1000;
+    static constexpr std::chrono::seconds response_timeout(10);
+
+    std::vector<pollfd> fds;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        // Health checks
+        auto now = std::chrono::steady_clock::now();
+        for (auto& process : processes) {
+            if (process.pid == -1) {
+                if (now >= process.restart_time) {
+                    try {
+                        start(process);
+                    } catch (const std::runtime_error& e) {
+                        std::cerr << "Warning: Failed to restart Whitaker's Words: " << e.what() << std::endl;
+                        restart(process);
+                    }
+                }
+            } else if (!process.requests.empty() && now - process.last_activity > response_timeout) {
+                std::cerr << "Warning: Whitaker's Words subprocess " << process.pid << " stopped responding, restarting it" << std::endl;
+                restart(process);
+            }
+        }
+        dispatch();
+
+        // Processes take up two slots each, which are ignored by poll while the process is down
+        fds.clear();
+        fds.push_back({wake_pipe[0], POLLIN, 0});
+        for (const auto& process : processes) {
+            fds.push_back({process.out, POLLIN, 0});
+            fds.push_back({process.input.empty() ? -1 : process.in, POLLOUT, 0});
+        }
+
+        lock.unlock();
+        poll(fds.data(), fds.size(), poll_interval);
+        lock.lock();
+
+        if (fds[0].revents) {
+            char buf[64];
+            while (read(wake_pipe[0], buf, sizeof buf) > 0) {}
+        }
+
+        for (size_t i = 0; i < processes.size(); ++i) {
+            Process& process = processes[i];
+            const pollfd& out_fd = fds[i * 2 + 1];
+            const pollfd& in_fd = fds[i * 2 + 2];
+            if (process.pid == -1) {
+                continue;
+            }
+
+            if (in_fd.revents) {
+                ssize_t n;
+                if ((n = write(process.in, process.input.data(), process.input.size())) >= 0) {
+                    process.input.erase(0, n);
+                } else if (errno != EAGAIN && errno != EINTR) {
+                    std::cerr << "Warning: Whitaker's Words subprocess " << process.pid << " stopped reading input, restarting it" << std::endl;
+                    restart(process);
+                    continue;
+                }
+            }
+
+            if (out_fd.revents && !read_output(process)) {
+                std::cerr << "Warning: Whitaker's Words subprocess " << process.pid << " exited, restarting it" << std::endl;
+                restart(process);
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stddef.h>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// A fixed set of Whitaker's Words subprocesses shared by every thread, and driven by a single event loop thread
+// Words are written to a process back-to-back without waiting for each answer, and answers are matched back up with their words by the prompts that follow them
+// Processes that crash or stop responding are killed and restarted, and the words they had been given are retried once
+class WhitakersWordsPool {
+protected:
+    struct Batch {
+        std::vector<std::string>* outputs;
+        size_t remaining;
+    };
+
+    struct Request {
+        const std::string* word;
+        Batch* batch;
+        size_t index;
+        unsigned attempts = 0;
+    };
+
+    struct Process {
+        pid_t pid = -1;
+        int in = -1;                  // The write end of the process's stdin
+        int out = -1;                 // The read end of the process's stdout
+        bool ready = false;           // Whether the startup banner has been read yet
+        std::string input;            // Written as the pipe has room
+        std::string output;           // Read but not yet split into answers
+        std::deque<Request> requests; // Written but not yet answered, in order
+        std::chrono::steady_clock::time_point last_activity;
+        std::chrono::steady_clock::time_point restart_time;
+        std::chrono::milliseconds restart_delay {0}; // Backs off while the process keeps exiting before it's ready
+    };
+
+    std::string start_dir;
+    std::string binary;
+    std::vector<Process> processes;
+    std::deque<Request> queue; // Requests that haven't been handed to a process yet
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    int wake_pipe[2];
+    bool stopping = false;
+    std::thread thread;
+
+    void start(Process& process);
+    void stop(Process& process);
+    void restart(Process& process);
+    void dispatch();
+    bool read_output(Process& process);
+    void complete(Request& request, std::string output);
+    void wake();
+    void run();
+
+public:
+    WhitakersWordsPool(const std::string& start_dir = "whitakers-words", size_t process_count = std::thread::hardware_concurrency(), const std::string& binary = "bin/words");
+    ~WhitakersWordsPool();
+
+    WhitakersWordsPool(const WhitakersWordsPool&) = delete;
+    WhitakersWordsPool& operator=(const WhitakersWordsPool&) = delete;
+
+    size_t size() const {
+        return processes.size();
+    }
+
+    // Looks up every word at once and blocks until all of them have been answered, filling in ret with each word's raw output
+    // Words must be made up of letters only, and output is left empty for words that crashed their processes twice
+    void query(const std::vector<std::string>& words, std::vector<std::string>& ret);
+};
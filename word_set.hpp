@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// A set of word indices packed into a bitset, which can be walked in ascending order while it's being modified
+class WordSet {
+protected:
+    std::vector<uint64_t> bits;
+    size_t size = 0;
+
+public:
+    // Resets the set to hold every index in [0, size)
+    void fill(size_t size) {
+        this->size = size;
+        bits.assign((size + 63) / 64, UINT64_MAX);
+        if (size % 64) {
+            bits.back() = ((uint64_t) 1 << (size % 64)) - 1;
+        }
+    }
+
+    void erase(size_t i) {
+        bits[i / 64] &= ~((uint64_t) 1 << (i % 64));
+    }
+
+    // Inserts every index from i - before to i + after, leaving out any that are out of bounds
+    void insert_around(size_t i, size_t before, size_t after) {
+        for (size_t j = i < before ? 0 : i - before; j <= i + after && j < size; ++j) {
+            bits[j / 64] |= (uint64_t) 1 << (j % 64);
+        }
+    }
+
+    // Returns the smallest index in the set that's at least i, or the set's size if there isn't one
+    size_t next(size_t i) const {
+        if (i >= size) {
+            return size;
+        }
+
+        size_t word = i / 64;
+        uint64_t remaining = bits[word] & (UINT64_MAX << (i % 64));
+        while (!remaining) {
+            if (++word == bits.size()) {
+                return size;
+            }
+            remaining = bits[word];
+        }
+        return word * 64 + __builtin_ctzll(remaining);
+    }
+};
@@ -2,6 +2,7 @@
 
 #include "json_fwd.hpp"
 #include <string>
+#include <string_view>
 
 enum PartOfSpeech {
     PART_OF_SPEECH_NOUN,
@@ -87,260 +88,133 @@ typedef unsigned short Declension;
 typedef unsigned short Conjugation;
 typedef unsigned short Person;
 
-class WordForm {
-public:
-    PartOfSpeech part_of_speech;
-
-    WordForm(PartOfSpeech part_of_speech):
-        part_of_speech(part_of_speech) {}
-
-    virtual ~WordForm() = default;
-    virtual std::string english_equivalent(const std::string& english_base) const = 0;
-    virtual std::string tokenize() const;
-    virtual nlohmann::json to_json() const;
-
-    virtual Casus get_casus() const { return CASUS_NONE; }
-    virtual Gender get_gender() const { return GENDER_NONE; }
-    virtual Degree get_degree() const { return DEGREE_NONE; }
-    virtual Tense get_tense() const { return TENSE_NONE; }
-    virtual Voice get_voice() const { return VOICE_NONE; }
-    virtual Mood get_mood() const { return MOOD_NONE; }
-    virtual NumeralType get_numeral_type() const { return NUMERAL_TYPE_NONE; }
-    virtual Declension get_declension() const { return 0; }
-    virtual Conjugation get_conjugation() const { return 0; }
-    virtual Person get_person() const { return 0; }
-    virtual bool is_plural() const { return false; }
-
-    virtual bool is_noun_like() const { return false; }
-};
-
-class Noun : public WordForm {
-public:
-    Declension declension;
-    Casus casus;
-    bool plural;
-    Gender gender;
-
-    Noun(PartOfSpeech part_of_speech = PART_OF_SPEECH_NOUN):
-        WordForm(part_of_speech) {}
-    Noun(Declension declension, Casus casus, bool plural, Gender gender):
-        WordForm(PART_OF_SPEECH_NOUN),
-        declension(declension),
-        casus(casus),
-        plural(plural),
-        gender(gender) {}
-
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
-
-    Casus get_casus() const override { return casus; }
-    Gender get_gender() const override { return gender; }
-    Declension get_declension() const override { return declension; }
-    bool is_plural() const override { return plural; }
-
-    bool is_noun_like() const override { return true; }
-};
-
-class Verb : public WordForm {
-public:
-    Conjugation conjugation;
-    Tense tense;
-    Voice voice;
-    Mood mood;
-    Person person;
-    bool plural;
-
-    Verb(PartOfSpeech part_of_speech = PART_OF_SPEECH_VERB):
-        WordForm(part_of_speech) {}
-    Verb(Conjugation conjugation, Tense tense, Voice voice, Mood mood, Person person, bool plural):
-        WordForm(PART_OF_SPEECH_VERB),
-        conjugation(conjugation),
-        tense(tense),
-        voice(voice),
-        mood(mood),
-        person(person),
-        plural(plural) {}
-
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
-
-    Tense get_tense() const override { return tense; }
-    Voice get_voice() const override { return voice; }
-    Mood get_mood() const override { return mood; }
-    Conjugation get_conjugation() const override { return conjugation; }
-    Person get_person() const override { return person; }
-    bool is_plural() const override { return plural; }
-};
-
-class Participle : public WordForm {
-public:
-    Conjugation conjugation;
-    Casus casus;
-    bool plural;
-    Gender gender;
-    Tense tense;
-    Voice voice;
-
-    Participle(PartOfSpeech part_of_speech = PART_OF_SPEECH_PARTICIPLE):
-        WordForm(part_of_speech) {}
-    Participle(Conjugation conjugation, Casus casus, bool plural, Gender gender, Tense tense, Voice voice):
-        WordForm(PART_OF_SPEECH_PARTICIPLE),
-        conjugation(conjugation),
-        casus(casus),
-        plural(plural),
-        gender(gender),
-        tense(tense),
-        voice(voice) {}
-
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
-
-    Casus get_casus() const override { return casus; }
-    Gender get_gender() const override { return gender; }
-    Tense get_tense() const override { return tense; }
-    Voice get_voice() const override { return voice; }
-    Conjugation get_conjugation() const override { return conjugation; }
-    bool is_plural() const override { return plural; }
-
-    bool is_noun_like() const override { return true; }
-};
-
-class Supine : public WordForm {
-public:
-    Conjugation conjugation;
-    Casus casus;
-    bool plural;
-    Gender gender;
-
-    Supine(PartOfSpeech part_of_speech = PART_OF_SPEECH_SUPINE):
-        WordForm(part_of_speech) {}
-    Supine(Conjugation conjugation, Casus casus, bool plural, Gender gender):
-        WordForm(PART_OF_SPEECH_SUPINE),
-        conjugation(conjugation),
-        casus(casus),
-        plural(plural),
-        gender(gender) {}
-
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
-
-    Casus get_casus() const override { return casus; }
-    Gender get_gender() const override { return gender; }
-    Conjugation get_conjugation() const override { return conjugation; }
-    bool is_plural() const override { return plural; }
-};
-
-class Adjective : public Noun {
-public:
-    Degree degree;
-
-    Adjective(PartOfSpeech part_of_speech = PART_OF_SPEECH_ADJECTIVE):
-        Noun(part_of_speech) {}
-    Adjective(Declension declension, Casus casus, bool plural, Gender gender, Degree degree):
-        Noun(declension, casus, plural, gender),
-        degree(degree) {
-        part_of_speech = PART_OF_SPEECH_ADJECTIVE;
+// A single morphological analysis, packed into 4 bytes so that forms can be stored contiguously and copied freely
+// Features that don't apply to the part of speech are NONE, or 0 for the person and declension
+struct WordForm {
+    PartOfSpeech part_of_speech : 4;
+    Casus casus : 3;
+    Gender gender : 3;
+    Degree degree : 2;
+    Tense tense : 3;
+    Voice voice : 2;
+    Mood mood : 3;
+    NumeralType numeral_type : 3;
+    unsigned int person : 2;
+    bool plural : 1;
+    unsigned int declension : 4; // Or conjugation
+
+    static WordForm make(PartOfSpeech part_of_speech) {
+        WordForm ret = {};
+        ret.part_of_speech = part_of_speech;
+        ret.casus = CASUS_NONE;
+        ret.gender = GENDER_NONE;
+        ret.degree = DEGREE_NONE;
+        ret.tense = TENSE_NONE;
+        ret.voice = VOICE_NONE;
+        ret.mood = MOOD_NONE;
+        ret.numeral_type = NUMERAL_TYPE_NONE;
+        ret.person = 0;
+        ret.plural = false;
+        ret.declension = 0;
+        return ret;
     }
 
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
-
-    Degree get_degree() const override { return degree; }
-
-    bool is_noun_like() const override { return false; }
-};
-
-class Adverb : public WordForm {
-public:
-    Degree degree;
-
-    Adverb(PartOfSpeech part_of_speech = PART_OF_SPEECH_ADVERB):
-        WordForm(part_of_speech) {}
-    Adverb(Degree degree):
-        WordForm(PART_OF_SPEECH_ADVERB),
-        degree(degree) {}
-
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
-
-    Degree get_degree() const override { return degree; }
-};
+    static WordForm make_noun(Declension declension, Casus casus, bool plural, Gender gender, PartOfSpeech part_of_speech = PART_OF_SPEECH_NOUN) {
+        WordForm ret = make(part_of_speech);
+        ret.declension = declension;
+        ret.casus = casus;
+        ret.plural = plural;
+        ret.gender = gender;
+        return ret;
+    }
 
-class Pronoun : public Noun {
-public:
-    Pronoun(PartOfSpeech part_of_speech = PART_OF_SPEECH_PRONOUN):
-        Noun(part_of_speech) {}
-    Pronoun(Declension declension, Casus casus, bool plural, Gender gender):
-        Noun(declension, casus, plural, gender) {
-        part_of_speech = PART_OF_SPEECH_PRONOUN;
+    static WordForm make_verb(Conjugation conjugation, Tense tense, Voice voice, Mood mood, Person person, bool plural) {
+        WordForm ret = make(PART_OF_SPEECH_VERB);
+        ret.declension = conjugation;
+        ret.tense = tense;
+        ret.voice = voice;
+        ret.mood = mood;
+        ret.person = person;
+        ret.plural = plural;
+        return ret;
     }
 
-    std::string english_equivalent(const std::string& english_base) const override;
-};
+    static WordForm make_participle(Conjugation conjugation, Casus casus, bool plural, Gender gender, Tense tense, Voice voice) {
+        WordForm ret = make_noun(conjugation, casus, plural, gender, PART_OF_SPEECH_PARTICIPLE);
+        ret.tense = tense;
+        ret.voice = voice;
+        return ret;
+    }
 
-class Conjunction : public WordForm {
-public:
-    Conjunction(PartOfSpeech part_of_speech = PART_OF_SPEECH_CONJUNCTION):
-        WordForm(part_of_speech) {}
+    static WordForm make_supine(Conjugation conjugation, Casus casus, bool plural, Gender gender) {
+        return make_noun(conjugation, casus, plural, gender, PART_OF_SPEECH_SUPINE);
+    }
 
-    std::string english_equivalent(const std::string& english_base) const override {
-        return english_base;
+    static WordForm make_adjective(Declension declension, Casus casus, bool plural, Gender gender, Degree degree) {
+        WordForm ret = make_noun(declension, casus, plural, gender, PART_OF_SPEECH_ADJECTIVE);
+        ret.degree = degree;
+        return ret;
     }
-};
 
-class Preposition : public WordForm {
-public:
-    Casus casus;
+    static WordForm make_adverb(Degree degree) {
+        WordForm ret = make(PART_OF_SPEECH_ADVERB);
+        ret.degree = degree;
+        return ret;
+    }
 
-    Preposition(PartOfSpeech part_of_speech = PART_OF_SPEECH_PREPOSITION):
-        WordForm(part_of_speech) {}
-    Preposition(Casus casus):
-        WordForm(PART_OF_SPEECH_PREPOSITION),
-        casus(casus) {}
+    static WordForm make_pronoun(Declension declension, Casus casus, bool plural, Gender gender) {
+        return make_noun(declension, casus, plural, gender, PART_OF_SPEECH_PRONOUN);
+    }
 
-    std::string english_equivalent(const std::string& english_base) const override {
-        return english_base;
+    static WordForm make_conjunction() {
+        return make(PART_OF_SPEECH_CONJUNCTION);
     }
 
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
+    static WordForm make_preposition(Casus casus) {
+        WordForm ret = make(PART_OF_SPEECH_PREPOSITION);
+        ret.casus = casus;
+        return ret;
+    }
 
-    Casus get_casus() const override { return casus; }
-};
+    static WordForm make_interjection() {
+        return make(PART_OF_SPEECH_INTERJECTION);
+    }
 
-class Interjection : public WordForm {
-public:
-    Interjection(PartOfSpeech part_of_speech = PART_OF_SPEECH_INTERJECTION):
-        WordForm(part_of_speech) {}
+    static WordForm make_numeral(Declension declension, Casus casus, bool plural, Gender gender, NumeralType numeral_type) {
+        WordForm ret = make_noun(declension, casus, plural, gender, PART_OF_SPEECH_NUMERAL);
+        ret.numeral_type = numeral_type;
+        return ret;
+    }
 
-    std::string english_equivalent(const std::string& english_base) const override {
-        return english_base;
+    Casus get_casus() const { return casus; }
+    Gender get_gender() const { return gender; }
+    Degree get_degree() const { return degree; }
+    Tense get_tense() const { return tense; }
+    Voice get_voice() const { return voice; }
+    Mood get_mood() const { return mood; }
+    NumeralType get_numeral_type() const { return numeral_type; }
+    Person get_person() const { return person; }
+    bool is_plural() const { return plural; }
+
+    bool is_verb_like() const {
+        return part_of_speech == PART_OF_SPEECH_VERB || part_of_speech == PART_OF_SPEECH_PARTICIPLE || part_of_speech == PART_OF_SPEECH_SUPINE;
     }
-};
 
-class Numeral : public Noun {
-public:
-    NumeralType type;
+    Declension get_declension() const { return is_verb_like() ? 0 : declension; }
+    Conjugation get_conjugation() const { return is_verb_like() ? declension : 0; }
 
-    Numeral(PartOfSpeech part_of_speech = PART_OF_SPEECH_NUMERAL):
-        Noun(part_of_speech) {}
-    Numeral(Declension declension, Casus casus, bool plural, Gender gender, NumeralType type):
-        Noun(declension, casus, plural, gender),
-        type(type) {
-        part_of_speech = PART_OF_SPEECH_NUMERAL;
+    bool is_noun_like() const {
+        return part_of_speech == PART_OF_SPEECH_NOUN || part_of_speech == PART_OF_SPEECH_PARTICIPLE || part_of_speech == PART_OF_SPEECH_PRONOUN;
     }
+};
 
-    std::string english_equivalent(const std::string& english_base) const override;
-    std::string tokenize() const override;
-    nlohmann::json to_json() const override;
+static_assert(sizeof(WordForm) == 4, "WordForm must fit in 4 bytes");
 
-    NumeralType get_numeral_type() const override { return type; }
+bool init_irregular_verbs(); // Loads irregular_verbs.json ahead of the first english_equivalent call, returning false if it has no verbs
+std::string english_equivalent(const WordForm& form, const std::string& english_base);
+std::string_view tokenize(const WordForm& form); // Points into a table that lives as long as the program
+void to_json(nlohmann::json& ret, const WordForm& form);
 
-    bool is_noun_like() const override { return false; }
-};
+// Appends JSON straight to ret, producing the same text as nlohmann::json's dump()
+void serialize_string(std::string& ret, std::string_view str);
+void serialize_form(std::string& ret, const WordForm& form, std::string_view english_equivalent); // Same as to_json plus english_equivalent
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+// A fixed set of long-lived threads, so that thread_local state (transliterators, sentence analyzers, etc.) is reused across jobs
+class WorkerPool {
+protected:
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_cv;
+    bool stopping = false;
+
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_cv.wait(lock, [this]() {
+                    return stopping || !tasks.empty();
+                });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    WorkerPool(size_t thread_count = std::thread::hardware_concurrency()) {
+        thread_count = std::max<size_t>(thread_count, 1);
+        threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        task_cv.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    void schedule(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        task_cv.notify_one();
+    }
+
+    // Calls cb(i) for every i in [0, count) across the pool, and blocks until every call has returned
+    // The first exception thrown by cb is rethrown here
+    template <typename F>
+    void parallel_for(size_t count, F cb) {
+        std::atomic<size_t> next_index(0);
+        size_t task_count = std::min(threads.size(), count);
+        size_t running = task_count;
+        std::exception_ptr exception;
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+
+        for (size_t i = 0; i < task_count; ++i) {
+            schedule([&]() {
+                try {
+                    for (size_t index; (index = next_index.fetch_add(1, std::memory_order_relaxed)) < count;) {
+                        cb(index);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                    next_index.store(count, std::memory_order_relaxed); // Stop handing out work
+                }
+
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (!--running) {
+                    done_cv.notify_one();
+                }
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [&running]() {
+            return !running;
+        });
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};